@@ -0,0 +1,102 @@
+/* Copyright 2024 NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "legate.h"
+#include "api/estimator.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+constexpr int64_t kRows     = 100000;
+constexpr int64_t kFeatures = 10;
+
+// Fills X with uniform features in [-1, 1] and y with sin(3 * x0) + x1 * x2 + noise
+void MakeRegression(legate::LogicalStore& X, legate::LogicalStore& y, int64_t n_rows)
+{
+  auto X_store = X.get_physical_store();
+  auto y_store = y.get_physical_store();
+  auto X_acc   = X_store.write_accessor<float, 2>();
+  auto y_acc   = y_store.write_accessor<double, 2>();
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  std::normal_distribution<double> noise(0.0, 0.1);
+  float x[kFeatures];
+  for (int64_t i = 0; i < n_rows; i++) {
+    for (int64_t j = 0; j < kFeatures; j++) {
+      x[j]          = uniform(rng);
+      X_acc[{i, j}] = x[j];
+    }
+    y_acc[{i, 0}] = std::sin(3.0 * x[0]) + x[1] * x[2] + noise(rng);
+  }
+}
+
+double MeanSquaredError(const legate::LogicalStore& a, const legate::LogicalStore& b, int64_t n)
+{
+  auto a_store = a.get_physical_store();
+  auto b_store = b.get_physical_store();
+  auto a_acc   = a_store.read_accessor<double, 2>();
+  auto b_acc   = b_store.read_accessor<double, 2>();
+  double sum   = 0.0;
+  for (int64_t i = 0; i < n; i++) {
+    double diff = a_acc[{i, 0}] - b_acc[{i, 0}];
+    sum += diff * diff;
+  }
+  return sum / n;
+}
+
+int main(int argc, char** argv)
+{
+  if (auto result = legate::start(argc, argv); result != 0) { return result; }
+  legateboost_perform_registration();
+
+  auto runtime = legate::Runtime::get_runtime();
+  auto X       = runtime->create_store(legate::Shape{kRows, kFeatures}, legate::float32());
+  auto y       = runtime->create_store(legate::Shape{kRows, 1}, legate::float64());
+  MakeRegression(X, y, kRows);
+
+  legateboost::LBParams params;
+  params.n_estimators   = 50;
+  params.learning_rate  = 0.3;
+  params.tree.max_depth = 6;
+
+  legateboost::LBRegressor regressor(params);
+  regressor.Fit(X, y);
+  std::printf("Regressor training MSE: %f\n", MeanSquaredError(regressor.Predict(X), y, kRows));
+
+  // Label rows by the sign of the regression target
+  auto labels = runtime->create_store(legate::Shape{kRows, 1}, legate::float64());
+  {
+    auto y_store     = y.get_physical_store();
+    auto label_store = labels.get_physical_store();
+    auto y_acc       = y_store.read_accessor<double, 2>();
+    auto label_acc   = label_store.write_accessor<double, 2>();
+    for (int64_t i = 0; i < kRows; i++) { label_acc[{i, 0}] = y_acc[{i, 0}] > 0.0 ? 1.0 : 0.0; }
+  }
+  legateboost::LBClassifier classifier(params);
+  classifier.Fit(X, labels);
+  {
+    auto proba_store = classifier.PredictProba(X).get_physical_store();
+    auto label_store = labels.get_physical_store();
+    auto proba_acc   = proba_store.read_accessor<double, 2>();
+    auto label_acc   = label_store.read_accessor<double, 2>();
+    int64_t correct  = 0;
+    for (int64_t i = 0; i < kRows; i++) {
+      correct += (proba_acc[{i, 0}] > 0.5) == (label_acc[{i, 0}] > 0.5);
+    }
+    std::printf("Classifier training accuracy: %f\n", double(correct) / kRows);
+  }
+
+  return legate::finish();
+}
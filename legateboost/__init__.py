@@ -23,5 +23,6 @@ from .objectives import (
 from .callbacks import (
     TrainingCallback,
     EarlyStopping,
+    PhaseProfile,
 )
 from .utils import mod_col_by_idx, pick_col_by_idx, set_col_by_idx
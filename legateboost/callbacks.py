@@ -1,10 +1,11 @@
 from abc import ABC
-from typing import Optional, Tuple
+from typing import Dict, List, Optional, Tuple
 
 import numpy as np
 
 from .legateboost import EvalResult, LBBase
 from .metrics import metrics
+from .utils import task_profiler
 
 
 class TrainingCallback(ABC):
@@ -159,3 +160,48 @@ class EarlyStopping(TrainingCallback):
 
         if self.prune_model and self.best_score is not None:
             model.models_ = model.models_[: self.best_score[0] + 1]
+
+
+class PhaseProfile(TrainingCallback):
+    """Callback recording where the native tasks of each round spend their
+    time. The build_tree, update_tree, predict, build_nn and gather tasks time
+    their phases and count the rows, histogram bins and bytes summed over
+    workers while training runs. See `legateboost.utils.PROFILE_FIELDS`.
+
+    Collecting the profile of a round waits for its tasks to finish, so
+    rounds no longer overlap. Use for diagnosis rather than production
+    training.
+
+    Args:
+        verbose (bool): Print the profile of each round.
+
+    Attributes:
+        history (List[Dict[str, Dict[str, float]]]): One entry per round,
+            mapping a task name to its fields summed over the round's
+            launches and the number of launches. Times are in seconds, summed
+            over the points of each launch.
+    """
+
+    def __init__(self, verbose: bool = False) -> None:
+        self.verbose = verbose
+        self.history: List[Dict[str, Dict[str, float]]] = []
+        super().__init__()
+
+    def before_training(self, model: LBBase) -> None:
+        self.history = []
+        task_profiler.collect()
+        task_profiler.enabled = True
+
+    def after_iteration(
+        self, model: LBBase, epoch: int, evals_result: EvalResult
+    ) -> bool:
+        self.history.append(task_profiler.collect())
+        if self.verbose:
+            for name, fields in self.history[-1].items():
+                summary = " ".join(f"{k}={v:.4g}" for k, v in fields.items() if v)
+                print(f"[{epoch}] {name}: {summary}")
+        return False
+
+    def after_training(self, model: LBBase) -> None:
+        task_profiler.enabled = False
+        task_profiler.collect()
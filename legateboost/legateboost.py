@@ -12,12 +12,13 @@ from typing_extensions import Self, TypeAlias
 
 import cunumeric as cn
 
+from . import special
 from .input_validation import check_sample_weight, check_X_y
 from .metrics import BaseMetric, metrics
 from .models import BaseModel, Tree
 from .objectives import BaseObjective, objectives
 from .shapley import global_shapley_attributions, local_shapley_attributions
-from .utils import PickleCunumericMixin, preround
+from .utils import PickleCunumericMixin, preround, runtime_trace, task_profiler
 
 if TYPE_CHECKING:
     from .callbacks import TrainingCallback
@@ -38,6 +39,7 @@ class LBBase(BaseEstimator, PickleCunumericMixin):
         callbacks: Sequence[TrainingCallback] = (),
         verbose: int = 0,
         random_state: Optional[np.random.RandomState] = None,
+        trace: bool = False,
     ) -> None:
         self.n_estimators = n_estimators
         self.objective = objective
@@ -47,6 +49,7 @@ class LBBase(BaseEstimator, PickleCunumericMixin):
         self.init = init
         self.verbose = verbose
         self.random_state = random_state
+        self.trace = trace
         self.model_init_: cn.ndarray
         self.callbacks = callbacks
         self.metrics_: list[BaseMetric]
@@ -186,19 +189,19 @@ class LBBase(BaseEstimator, PickleCunumericMixin):
         )
         assert g.shape == h.shape
 
-        # apply weights and learning rate
-        g = g * sample_weight[:, None] * learning_rate
+        # apply weights, learning rate and subsample in one pass
+        w = special.expr(cn.broadcast_to(sample_weight[:, None], g.shape))
+        g_ = special.expr(g) * w * learning_rate
         # ensure hessians are not too small for numerical stability
-        h = cn.maximum(h * sample_weight[:, None], 1e-8)
-
-        # apply subsample
+        h_ = special.maximum(special.expr(h) * w, 1e-8)
         if self.subsample < 1.0:
             generator = cn.random.Generator(
                 cn.random.XORWOW(seed=self.random_state_.randint(0, 2**32))
             )
             mask = generator.binomial(1, self.subsample, size=y.shape[0])
-            g *= mask[:, None]
-            h *= mask[:, None]
+            mask_ = special.expr(cn.broadcast_to(mask[:, None], g.shape))
+            g_, h_ = g_ * mask_, h_ * mask_
+        g, h = special.evaluate(g_, h_)
 
         return preround(g), preround(h)
 
@@ -229,59 +232,77 @@ class LBBase(BaseEstimator, PickleCunumericMixin):
         train_pred = self._predict(X)
         eval_preds = [self._predict(X_eval) for X_eval, _, _ in _eval_set]
 
-        # callbacks before training
-        for c in self.callbacks:
-            c.before_training(self)
-
-        for i in range(self.n_estimators):
-
-            # callbacks before iteration
-            if any((c.before_iteration(self, i, eval_result) for c in self.callbacks)):
-                break
-
-            # obtain gradients
-            g, h = self._get_weighted_gradient(
-                y, train_pred, sample_weight, self.learning_rate
-            )
-
-            # build new model
-            self.models_.append(
-                deepcopy(self.base_models[i % len(self.base_models)])
-                .set_random_state(self.random_state_)
-                .fit(X, g, h)
-            )
-
-            # update current predictions
-            train_pred += self.models_[-1].predict(X)
-            for i, (X_eval, _, _) in enumerate(_eval_set):
-                eval_preds[i] += self.models_[-1].predict(X_eval)
-
-            # evaluate our progress
-            model_idx = len(self.models_) - 1
-            self._compute_metrics(
-                model_idx,
-                train_pred,
-                eval_preds,
-                y,
-                sample_weight,
-                self._metrics,
-                self.verbose,
-                _eval_set,
-                eval_result,
-            )
-
-            # callbacks after iteration
-            if any(
-                (
-                    c.after_iteration(self, model_idx, eval_result)
-                    for c in self.callbacks
+        # profiling switched on by a callback ends with training
+        with task_profiler.scope():
+            # callbacks before training
+            for c in self.callbacks:
+                c.before_training(self)
+
+            for i in range(self.n_estimators):
+
+                # callbacks before iteration
+                if any(
+                    (c.before_iteration(self, i, eval_result) for c in self.callbacks)
+                ):
+                    break
+
+                # count rounds over every model fitted so far, so that after an
+                # earlier fit or partial_fit the previous model of a base model is
+                # still the last one fitted from it
+                n_base_models = len(self.base_models)
+                base_model_idx = len(self.models_) % n_base_models
+                previous_model = (
+                    self.models_[-n_base_models]
+                    if len(self.models_) >= n_base_models
+                    else None
                 )
-            ):
-                break
-
-        # callbacks after training
-        for c in self.callbacks:
-            c.after_training(self)
+                # the first round of each base model may differ from the following
+                # ones, so it is not traced
+                with runtime_trace(
+                    base_model_idx, enabled=self.trace and previous_model is not None
+                ):
+                    # obtain gradients
+                    g, h = self._get_weighted_gradient(
+                        y, train_pred, sample_weight, self.learning_rate
+                    )
+
+                    # build new model and update current predictions
+                    model = (
+                        deepcopy(self.base_models[base_model_idx])
+                        .set_random_state(self.random_state_)
+                        .set_previous_model(previous_model)
+                    )
+                    train_pred += model.fit_predict(X, g, h)
+                    self.models_.append(model)
+                    for j, (X_eval, _, _) in enumerate(_eval_set):
+                        eval_preds[j] += self.models_[-1].predict(X_eval)
+
+                    # evaluate our progress
+                    model_idx = len(self.models_) - 1
+                    self._compute_metrics(
+                        model_idx,
+                        train_pred,
+                        eval_preds,
+                        y,
+                        sample_weight,
+                        self._metrics,
+                        self.verbose,
+                        _eval_set,
+                        eval_result,
+                    )
+
+                # callbacks after iteration
+                if any(
+                    (
+                        c.after_iteration(self, model_idx, eval_result)
+                        for c in self.callbacks
+                    )
+                ):
+                    break
+
+            # callbacks after training
+            for c in self.callbacks:
+                c.after_training(self)
 
         return self
 
@@ -588,6 +609,13 @@ class LBRegressor(LBBase, RegressorMixin):
     random_state :
         Controls the randomness of the estimator. Pass an int for reproducible
         results across multiple function calls.
+    trace :
+        Record each boosting round as a runtime trace so that dependence
+        analysis and mapping are replayed instead of repeated, reducing
+        runtime overhead per round on small and medium datasets. Each base
+        model is traced from its second round on. Rounds must issue the same
+        operations, so callbacks that launch work inside a round should not be
+        combined with tracing.
 
     Attributes
     ----------
@@ -626,6 +654,7 @@ class LBRegressor(LBBase, RegressorMixin):
         callbacks: Sequence[TrainingCallback] = (),
         verbose: int = 0,
         random_state: Optional[np.random.RandomState] = None,
+        trace: bool = False,
     ) -> None:
         super().__init__(
             n_estimators=n_estimators,
@@ -638,6 +667,7 @@ class LBRegressor(LBBase, RegressorMixin):
             callbacks=callbacks,
             verbose=verbose,
             random_state=random_state,
+            trace=trace,
         )
 
     def _more_tags(self) -> Any:
@@ -762,6 +792,13 @@ class LBClassifier(LBBase, ClassifierMixin):
     random_state :
         Controls the randomness of the estimator. Pass an int for reproducible output
         across multiple function calls.
+    trace :
+        Record each boosting round as a runtime trace so that dependence
+        analysis and mapping are replayed instead of repeated, reducing
+        runtime overhead per round on small and medium datasets. Each base
+        model is traced from its second round on. Rounds must issue the same
+        operations, so callbacks that launch work inside a round should not be
+        combined with tracing.
 
     Attributes
     ----------
@@ -801,6 +838,7 @@ class LBClassifier(LBBase, ClassifierMixin):
         callbacks: Sequence[TrainingCallback] = (),
         verbose: int = 0,
         random_state: Optional[np.random.RandomState] = None,
+        trace: bool = False,
     ) -> None:
         super().__init__(
             n_estimators=n_estimators,
@@ -813,6 +851,7 @@ class LBClassifier(LBBase, ClassifierMixin):
             callbacks=callbacks,
             verbose=verbose,
             random_state=random_state,
+            trace=trace,
         )
 
     def partial_fit(
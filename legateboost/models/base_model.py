@@ -1,4 +1,5 @@
 from abc import ABC, abstractmethod
+from typing import Optional
 
 import numpy as np
 
@@ -19,6 +20,23 @@ class BaseModel(PickleCunumericMixin, ABC):
         self.random_state = random_state
         return self
 
+    def set_previous_model(self, model: Optional["BaseModel"]) -> "BaseModel":
+        """Receive the model fitted from the same base model in the previous
+        boosting round, or None in the first round. Called before `fit`.
+        Models may use it as a starting point, the default ignores it.
+
+        Parameters
+        ----------
+        model :
+            The previous model. Must not be modified.
+
+        Returns
+        -------
+        BaseModel
+            Self.
+        """
+        return self
+
     @abstractmethod
     def fit(
         self,
@@ -47,6 +65,35 @@ class BaseModel(PickleCunumericMixin, ABC):
         """
         pass
 
+    def fit_predict(
+        self,
+        X: cn.ndarray,
+        g: cn.ndarray,
+        h: cn.ndarray,
+    ) -> cn.ndarray:
+        """Fit the model and return its predictions for the training data.
+        Models that can predict the training rows while fitting should
+        override this to save a separate prediction pass. The default calls
+        `fit` then `predict`.
+
+        Parameters
+        ----------
+        X :
+            The training data.
+        g :
+            The first derivative of the loss function with
+            respect to the predicted values.
+        h :
+            The second derivative of the loss function with
+             respect to the predicted values.
+
+        Returns
+        -------
+        cn.ndarray
+            The predictions of the fitted model for X.
+        """
+        return self.fit(X, g, h).predict(X)
+
     @abstractmethod
     def update(
         self,
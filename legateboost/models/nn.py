@@ -1,14 +1,70 @@
-from typing import Any, List, Tuple
+from typing import Any, List, Optional, Tuple
 
 import cunumeric as cn
 from legate.core import TaskTarget, get_legate_runtime, types
 
 from ..library import user_context, user_lib
-from ..utils import get_store
+from ..utils import get_store, single_rank_launch, task_profiler
 from .base_model import BaseModel
 
 
+# Must match the Activation enum in build_nn.h
+_ACTIVATIONS = {"tanh": 0, "relu": 1, "leaky_relu": 2, "silu": 3}
+_LEAKY_RELU_SLOPE = 0.01
+# Must match the NNSolver enum in build_nn.h
+_SOLVERS = {"lbfgs": 0, "adam": 1, "sgd": 2}
+
+
 class NN(BaseModel):
+    """Multi-layer perceptron base model.
+
+    Parameters
+    ----------
+    max_iter :
+        Maximum number of L-BFGS iterations, or the number of epochs for the
+        'adam' and 'sgd' solvers.
+    hidden_layer_sizes :
+        Number of units in each hidden layer.
+    alpha :
+        L2 regularization parameter.
+    verbose :
+        Print progress every `verbose` iterations.
+    m :
+        Number of L-BFGS correction pairs.
+    gtol :
+        L-BFGS stops when the gradient norm falls below this value.
+    activation :
+        Hidden layer activation. Options are 'tanh', 'relu', 'leaky_relu' and
+        'silu'.
+    solver :
+        Options are 'lbfgs' (full batch), 'adam' and 'sgd' (mini-batch).
+    batch_size :
+        Mini-batch size for the 'adam' and 'sgd' solvers, summed over all
+        workers.
+    learning_rate_init :
+        Step size for the 'adam' and 'sgd' solvers.
+    allreduce_interval :
+        For the 'adam' and 'sgd' solvers. If 1, gradients are summed across
+        workers every step. Otherwise each worker steps on its own batches and
+        the parameters are averaged every `allreduce_interval` steps.
+    workspace_budget :
+        For the 'lbfgs' solver. Maximum bytes of scratch memory per worker. If
+        the activations of all local rows do not fit, rows are streamed through
+        the network in blocks, at the cost of an extra forward pass per
+        iteration. None places no limit.
+    warm_start :
+        Start each boosting round from the weights of the NN fitted from the
+        same base model in the previous round instead of a fresh random
+        initialisation. Consecutive rounds see correlated gradients, so L-BFGS
+        typically converges in fewer iterations. Falls back to random
+        initialisation if the layer shapes differ.
+    warm_start_scale :
+        Multiplier applied to the previous round's weights when warm starting.
+    warm_start_noise :
+        Uniform noise added to the previous round's weights when warm starting,
+        as a fraction of the Glorot initialisation bound of each layer.
+    """
+
     def __init__(
         self,
         max_iter: int = 100,
@@ -17,6 +73,15 @@ class NN(BaseModel):
         verbose: bool = False,
         m: int = 10,
         gtol: float = 1e-5,
+        activation: str = "tanh",
+        solver: str = "lbfgs",
+        batch_size: int = 256,
+        learning_rate_init: float = 1e-3,
+        allreduce_interval: int = 1,
+        workspace_budget: Optional[int] = None,
+        warm_start: bool = False,
+        warm_start_scale: float = 1.0,
+        warm_start_noise: float = 0.0,
     ):
         self.max_iter = max_iter
         self.hidden_layer_sizes = hidden_layer_sizes
@@ -24,19 +89,39 @@ class NN(BaseModel):
         self.m = m
         self.alpha = alpha
         self.gtol = gtol
+        self.activation = activation
+        self.solver = solver
+        self.batch_size = batch_size
+        self.learning_rate_init = learning_rate_init
+        self.allreduce_interval = allreduce_interval
+        self.workspace_budget = workspace_budget
+        self.warm_start = warm_start
+        self.warm_start_scale = warm_start_scale
+        self.warm_start_noise = warm_start_noise
 
-    def tanh(self, x: cn.ndarray) -> cn.ndarray:
-        cn.tanh(x, out=x)
+    def _activation_code(self) -> int:
+        if self.activation not in _ACTIVATIONS:
+            raise ValueError(f"Unknown activation {self.activation}")
+        return _ACTIVATIONS[self.activation]
 
-    def tanh_prime(self, H: cn.ndarray, delta: cn.ndarray) -> None:
-        delta *= 1 - H**2
+    def activate(self, x: cn.ndarray) -> None:
+        if self.activation == "tanh":
+            cn.tanh(x, out=x)
+        elif self.activation == "relu":
+            cn.maximum(x, 0, out=x)
+        elif self.activation == "leaky_relu":
+            x[:] = cn.where(x > 0, x, _LEAKY_RELU_SLOPE * x)
+        elif self.activation == "silu":
+            x /= 1 + cn.exp(-x)
+        else:
+            raise ValueError(f"Unknown activation {self.activation}")
 
     def forward(self, X: cn.ndarray, activations: List[cn.ndarray]) -> List[cn.ndarray]:
         for i in range(len(self.hidden_layer_sizes) + 1):
             activations[i + 1] = activations[i].dot(self.coefficients_[i])
             activations[i + 1] += self.biases_[i][0]
             if i + 1 < len(self.hidden_layer_sizes) + 1:
-                self.tanh(activations[i + 1])
+                self.activate(activations[i + 1])
         return activations
 
     def _fit_lbfgs(self, X: cn.ndarray, g: cn.ndarray, h: cn.ndarray) -> "NN":
@@ -55,6 +140,15 @@ class NN(BaseModel):
         task.add_scalar_arg(self.m, types.int32)
         task.add_scalar_arg(self.max_iter, types.int32)
         task.add_scalar_arg(self.alpha, types.float64)
+        task.add_scalar_arg(self._activation_code(), types.int32)
+        if self.solver not in _SOLVERS:
+            raise ValueError(f"Unknown solver {self.solver}")
+        task.add_scalar_arg(_SOLVERS[self.solver], types.int32)
+        task.add_scalar_arg(self.batch_size, types.int64)
+        task.add_scalar_arg(self.learning_rate_init, types.float64)
+        task.add_scalar_arg(self.allreduce_interval, types.int32)
+        task.add_scalar_arg(self.random_state.randint(0, 2**31), types.int32)
+        task.add_scalar_arg(self.workspace_budget or 0, types.int64)
         task.add_input(X_)
         task.add_input(g_)
         task.add_input(h_)
@@ -68,14 +162,54 @@ class NN(BaseModel):
             task.add_output(b_)
             task.add_broadcast(get_store(c))
             task.add_broadcast(b_)
-        if get_legate_runtime().machine.count(TaskTarget.GPU) > 1:
-            task.add_nccl_communicator()
-        if get_legate_runtime().machine.count() > 1:
-            task.add_cpu_communicator()
+        # the GPU variant uses both communicators
+        if not single_rank_launch(task, X.shape[0], [X_, g_, h_]):
+            if get_legate_runtime().machine.count(TaskTarget.GPU) > 1:
+                task.add_nccl_communicator()
+            if get_legate_runtime().machine.count() > 1:
+                task.add_cpu_communicator()
+        task_profiler.add_to(task, "build_nn")
         task.execute()
         return self
 
+    def set_previous_model(self, model: Optional[BaseModel]) -> "NN":
+        self._previous_model = model
+        return self
+
+    def _warm_start_model(self, n_features: int, n_outputs: int) -> Optional["NN"]:
+        previous = getattr(self, "_previous_model", None)
+        if not self.warm_start or not isinstance(previous, NN):
+            return None
+        sizes = [n_features] + list(self.hidden_layer_sizes) + [n_outputs]
+        shapes = [(sizes[i], sizes[i + 1]) for i in range(len(sizes) - 1)]
+        if [c.shape for c in previous.coefficients_] != shapes:
+            return None
+        return previous
+
+    def _init_from_previous(self, previous: "NN", dtype: Any) -> None:
+        self.coefficients_ = []
+        self.biases_ = []
+        for c, b in zip(previous.coefficients_, previous.biases_):
+            n, m = c.shape
+            bound = self.warm_start_noise * (6.0 / (n + m)) ** 0.5
+            for src, dst in ((c, self.coefficients_), (b, self.biases_)):
+                # BUILD_NN updates its inputs in place, so always copy
+                layer = (src * self.warm_start_scale).astype(dtype)
+                if bound > 0.0:
+                    layer += cn.array(
+                        self.random_state.uniform(-bound, bound, size=src.shape),
+                        dtype=dtype,
+                    )
+                dst.append(layer)
+
     def fit(self, X: cn.ndarray, g: cn.ndarray, h: cn.ndarray) -> Any:
+        previous = self._warm_start_model(X.shape[1], g.shape[1])
+        # do not hold on to the previous round's model after fitting
+        self._previous_model = None
+        if previous is not None:
+            self._init_from_previous(previous, X.dtype)
+            return self._fit_lbfgs(X, g, h)
+
         # init layers with glorot initialization
         self.coefficients_ = []
         self.biases_ = []
@@ -113,8 +247,29 @@ class NN(BaseModel):
         return self._fit_lbfgs(X, g, h)
 
     def predict(self, X: cn.ndarray) -> cn.ndarray:
-        activations = [X] + [None] * len(self.hidden_layer_sizes) + [None]
-        return self.forward(X, activations)[-1]
+        n_rows = X.shape[0]
+        n_features = X.shape[1]
+        n_outputs = self.coefficients_[-1].shape[1]
+        task = get_legate_runtime().create_auto_task(
+            user_context, user_lib.cffi.PREDICT_NN
+        )
+        X_ = get_store(X).promote(2, n_outputs)
+        pred = get_legate_runtime().create_store(X_.type, (n_rows, n_outputs))
+        pred_ = get_store(pred).promote(1, n_features)
+        task.add_scalar_arg(self._activation_code(), types.int32)
+        task.add_input(X_)
+        task.add_broadcast(X_, (1, 2))
+        for c, b in zip(self.coefficients_, self.biases_):
+            c_ = get_store(c)
+            b_ = get_store(b).project(0, 0)
+            task.add_input(c_)
+            task.add_input(b_)
+            task.add_broadcast(c_)
+            task.add_broadcast(b_)
+        task.add_output(pred_)
+        task.add_alignment(X_, pred_)
+        task.execute()
+        return cn.array(pred, copy=False)
 
     def clear(self) -> None:
         for c in self.coefficients_:
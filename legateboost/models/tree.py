@@ -1,11 +1,17 @@
 from enum import IntEnum
-from typing import Any
+from typing import Any, Optional
 
 import cunumeric as cn
-from legate.core import TaskTarget, get_legate_runtime, types
+from legate.core import get_legate_runtime, types
 
 from ..library import user_context, user_lib
-from ..utils import get_store
+from ..utils import (
+    add_communicator,
+    get_store,
+    get_tunable,
+    single_rank_launch,
+    task_profiler,
+)
 from .base_model import BaseModel
 
 
@@ -15,6 +21,11 @@ class LegateBoostOpCode(IntEnum):
     UPDATE_TREE = user_lib.cffi.UPDATE_TREE
 
 
+# Must match the HistogramExchange enum in build_tree.h
+_HISTOGRAM_EXCHANGE = {"dense": 0, "auto": 1, "float32": 2}
+_PARTITIONS = ("rows", "features")
+
+
 class Tree(BaseModel):
     """Decision tree model for gradient boosting.
 
@@ -24,14 +35,50 @@ class Tree(BaseModel):
     XGBoost/LightGBM, where the `split_samples` parameter can be tuned like
     the number of bins.
 
+    `split_samples` and `histogram_chunks` left as None take the mapper's
+    values. With LEGATEBOOST_CALIBRATE=1 the mapper of every node calibrates on
+    its own and the results can differ between nodes. The value used is the
+    one the first rank's mapper returns for the tunable query. It is passed to
+    every worker as a task argument, so all workers build the tree with the
+    same value.
+
     Parameters
     ----------
     max_depth : int
         The maximum depth of the tree.
-    split_samples : int
-        The number of data points to sample for each split decision.
+    split_samples : Optional[int]
+        The number of data points to sample for each split decision. None uses
+        the mapper's value, 256 unless the environment variable
+        LEGATEBOOST_CALIBRATE=1 is set, in which case it is measured for the
+        machine's cache at startup.
     alpha : float
         The L2 regularization parameter.
+    histogram_chunks : Optional[int]
+        Each level's histogram is summed across workers in up to this many
+        chunks of nodes. Chunks that have arrived are scanned and searched for
+        splits while later chunks are still being communicated. None uses the
+        mapper's value, 4, or 1 for a single worker if LEGATEBOOST_CALIBRATE=1
+        is set.
+    histogram_exchange : str
+        How histograms are sent between workers. 'dense' sums every bin in
+        float64. 'auto' sends only the non-empty bins as (index, value) pairs
+        when that moves fewer bytes, which is common at deep levels. 'float32'
+        is 'auto' with values sent as float32, halving traffic at some cost in
+        precision.
+    partition : str
+        How the training data is divided between workers. With 'rows' each
+        worker holds a block of rows and histograms are summed across workers.
+        With 'features' each worker holds every row of a block of features,
+        searches splits over its own features only and exchanges just the best
+        split of each node, which avoids histogram traffic for wide datasets
+        with few rows.
+    voting_top_k : int
+        If positive and the data is partitioned by rows, use voting parallel
+        split search. Each worker nominates its `voting_top_k` best features for
+        each node from its local histogram and only the histograms of the
+        2 * `voting_top_k` most voted features are summed across workers, so
+        communication does not grow with the number of features. Splits may
+        differ from an exact search. 0 sums the histograms of all features.
     """
 
     leaf_value: cn.ndarray
@@ -53,12 +100,20 @@ class Tree(BaseModel):
     def __init__(
         self,
         max_depth: int = 8,
-        split_samples: int = 256,
+        split_samples: Optional[int] = None,
         alpha: float = 1.0,
+        histogram_chunks: Optional[int] = None,
+        histogram_exchange: str = "auto",
+        partition: str = "rows",
+        voting_top_k: int = 0,
     ) -> None:
         self.max_depth = max_depth
         self.split_samples = split_samples
         self.alpha = alpha
+        self.histogram_chunks = histogram_chunks
+        self.histogram_exchange = histogram_exchange
+        self.partition = partition
+        self.voting_top_k = voting_top_k
 
     def fit(
         self,
@@ -66,7 +121,39 @@ class Tree(BaseModel):
         g: cn.ndarray,
         h: cn.ndarray,
     ) -> "Tree":
+        self._fit(X, g, h, predict=False)
+        return self
+
+    def fit_predict(self, X: cn.ndarray, g: cn.ndarray, h: cn.ndarray) -> cn.ndarray:
+        if self.partition == "features":
+            # every worker holds all rows, so they would all write the
+            # predictions
+            return super().fit_predict(X, g, h)
+        pred = self._fit(X, g, h, predict=True)
+        assert pred is not None
+        return pred
+
+    def _fit(
+        self, X: cn.ndarray, g: cn.ndarray, h: cn.ndarray, predict: bool
+    ) -> Optional[cn.ndarray]:
         num_outputs = g.shape[1]
+        split_samples = self.split_samples
+        if split_samples is None:
+            split_samples = get_tunable(user_lib.cffi.TUNABLE_SPLIT_SAMPLES)
+        histogram_chunks = self.histogram_chunks
+        if histogram_chunks is None:
+            histogram_chunks = get_tunable(user_lib.cffi.TUNABLE_HISTOGRAM_CHUNKS)
+        if histogram_chunks < 1:
+            raise ValueError("histogram_chunks must be at least 1")
+        if self.histogram_exchange not in _HISTOGRAM_EXCHANGE:
+            raise ValueError(f"Unknown histogram_exchange {self.histogram_exchange}")
+        if self.partition not in _PARTITIONS:
+            raise ValueError(f"Unknown partition {self.partition}")
+        feature_parallel = self.partition == "features"
+        if self.voting_top_k < 0:
+            raise ValueError("voting_top_k must not be negative")
+        if self.voting_top_k > 0 and feature_parallel:
+            raise ValueError("voting_top_k requires partition='rows'")
 
         task = get_legate_runtime().create_auto_task(
             user_context, LegateBoostOpCode.BUILD_TREE
@@ -81,12 +168,22 @@ class Tree(BaseModel):
         max_nodes = 2 ** (self.max_depth + 1)
         task.add_scalar_arg(max_nodes, types.int32)
         task.add_scalar_arg(self.alpha, types.float64)
-        task.add_scalar_arg(self.split_samples, types.int32)
+        task.add_scalar_arg(split_samples, types.int32)
         task.add_scalar_arg(self.random_state.randint(0, 2**31), types.int32)
         task.add_scalar_arg(X.shape[0], types.int64)
+        task.add_scalar_arg(histogram_chunks, types.int32)
+        task.add_scalar_arg(_HISTOGRAM_EXCHANGE[self.histogram_exchange], types.int32)
+        # read by the mapper at BUILD_TREE_FEATURE_PARALLEL in legateboost.h,
+        # keep the position in sync when adding scalars before it
+        task.add_scalar_arg(feature_parallel, types.bool_)
+        task.add_scalar_arg(self.voting_top_k, types.int32)
 
         task.add_input(X_)
-        task.add_broadcast(X_, 1)
+        if feature_parallel:
+            # every worker sees all rows of its features
+            task.add_broadcast(X_, (0, 2))
+        else:
+            task.add_broadcast(X_, 1)
         task.add_input(g_)
         task.add_input(h_)
         task.add_alignment(g_, h_)
@@ -113,10 +210,21 @@ class Tree(BaseModel):
         task.add_broadcast(gain)
         task.add_broadcast(hessian)
 
-        if get_legate_runtime().machine.count(TaskTarget.GPU) > 1:
-            task.add_nccl_communicator()
-        elif get_legate_runtime().machine.count() > 1:
-            task.add_cpu_communicator()
+        # predictions for the training rows, from the leaves they reach
+        if predict:
+            pred = get_legate_runtime().create_store(
+                types.float64, (X.shape[0], num_outputs)
+            )
+            pred_ = get_store(pred).promote(1, X.shape[1])
+            task.add_output(pred_)
+            task.add_alignment(g_, pred_)
+
+        row_stores = [X_, g_, h_] + ([pred_] if predict else [])
+        # feature partitioning targets wide data with few rows, so it is never
+        # collapsed onto one rank by the row count
+        if feature_parallel or not single_rank_launch(task, X.shape[0], row_stores):
+            add_communicator(task)
+        task_profiler.add_to(task, "build_tree")
         task.execute()
 
         self.leaf_value = cn.array(leaf_value, copy=False)
@@ -124,7 +232,7 @@ class Tree(BaseModel):
         self.split_value = cn.array(split_value, copy=False)
         self.gain = cn.array(gain, copy=False)
         self.hessian = cn.array(hessian, copy=False)
-        return self
+        return cn.array(pred, copy=False) if predict else None
 
     def clear(self) -> None:
         self.leaf_value.fill(0)
@@ -144,7 +252,6 @@ class Tree(BaseModel):
         X_ = get_store(X).promote(2, g.shape[1])
         g_ = get_store(g).promote(1, X.shape[1])
         h_ = get_store(h).promote(1, X.shape[1])
-        task.add_scalar_arg(self.alpha, types.float64)
         task.add_input(X_)
         task.add_broadcast(X_, 1)
         task.add_input(g_)
@@ -158,20 +265,23 @@ class Tree(BaseModel):
         task.add_input(get_store(self.split_value))
         task.add_broadcast(get_store(self.split_value))
 
-        leaf_value = get_legate_runtime().create_store(
-            types.float64, self.leaf_value.shape
-        )
-        hessian = get_legate_runtime().create_store(types.float64, self.hessian.shape)
-
-        task.add_output(leaf_value)
-        task.add_output(hessian)
-
-        # Update task has only a CPU implementation
-        task.add_cpu_communicator()
+        # node statistics are summed over workers by the runtime, so no
+        # communicator is needed
+        gradient = cn.zeros(self.leaf_value.shape)
+        hessian = cn.zeros(self.hessian.shape)
+        for stats in (gradient, hessian):
+            task.add_reduction(get_store(stats), types.ReductionOpKind.ADD)
+            task.add_broadcast(get_store(stats))
 
+        single_rank_launch(task, X.shape[0], [X_, g_, h_])
+        task_profiler.add_to(task, "update_tree")
         task.execute()
-        self.leaf_value = cn.array(leaf_value, copy=False)
-        self.hessian = cn.array(hessian, copy=False)
+
+        # Must match CalculateLeafValue in build_tree.h
+        self.leaf_value = cn.where(
+            hessian > 0.0, -gradient / (hessian + self.alpha), 0.0
+        )
+        self.hessian = hessian
         return self
 
     def predict(self, X: cn.ndarray) -> cn.ndarray:
@@ -202,6 +312,8 @@ class Tree(BaseModel):
         task.add_output(pred_)
 
         task.add_alignment(X_, pred_)
+        single_rank_launch(task, n_rows, [X_, pred_])
+        task_profiler.add_to(task, "predict")
         task.execute()
 
         return cn.array(pred, copy=False)
@@ -174,15 +174,17 @@ class NormalObjective(BaseObjective, Forecast):
     def gradient(self, y: cn.ndarray, pred: cn.ndarray) -> GradPair:
         grad = cn.zeros((y.shape[0], y.shape[1], 2))
         hess = cn.ones((y.shape[0], y.shape[1], 2))
-        mean = pred[:, :, 0]
-        log_sigma = pred[:, :, 1]
-        inv_var = cn.exp(-2 * log_sigma)
-        assert log_sigma.ndim == 2
-        diff = mean - y
-        grad[:, :, 0] = diff * inv_var
-        hess[:, :, 0] = inv_var  # fisher information
-
-        grad[:, :, 1] = 1 - inv_var * diff * diff
+        assert pred[:, :, 1].ndim == 2
+        # one fused pass instead of a task and temporary per operation
+        mean = special.expr(pred[:, :, 0])
+        log_sigma = special.expr(pred[:, :, 1])
+        inv_var = (-2 * log_sigma).exp()
+        diff = mean - special.expr(y)
+        grad[:, :, 0], grad[:, :, 1], hess[:, :, 0] = special.evaluate(
+            diff * inv_var,
+            1 - inv_var * diff * diff,
+            inv_var,  # fisher information
+        )
         hess[:, :, 1] = 2  # fisher information
         return grad.reshape(grad.shape[0], -1), hess.reshape(hess.shape[0], -1)
 
@@ -319,13 +321,16 @@ class GammaObjective(FitInterceptRegMixIn, Forecast):
         grad = cn.empty((y.shape[0], y.shape[1], 2))
         fisher = cn.empty((y.shape[0], y.shape[1], 2))
 
-        shape = pred[:, :, 0]
-        scale = pred[:, :, 1]
-        grad[:, :, 0] = shape * (special.digamma(shape) + cn.log(scale) - cn.log(y))
-        grad[:, :, 1] = shape - (1 / scale * y)
-
-        fisher[:, :, 0] = special.polygamma(1, shape) * shape**2
-        fisher[:, :, 1] = shape
+        # one fused pass instead of a task and temporary per operation
+        shape = special.expr(pred[:, :, 0])
+        scale = special.expr(pred[:, :, 1])
+        y_ = special.expr(y)
+        grad[:, :, 0], grad[:, :, 1], fisher[:, :, 0] = special.evaluate(
+            shape * (special.digamma(shape) + scale.log() - y_.log()),
+            shape - (1 / scale * y_),
+            special.polygamma(1, shape) * shape**2,
+        )
+        fisher[:, :, 1] = pred[:, :, 0]
 
         fisher = fisher.reshape(fisher.shape[0], -1)
         assert fisher.ndim == 2
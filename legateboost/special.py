@@ -14,7 +14,11 @@
 #
 from __future__ import annotations
 
+import math
 from enum import IntEnum
+from typing import Any, Dict, List, Tuple
+
+import numpy as np
 
 import cunumeric as cn
 from legate.core import get_legate_runtime, types as ty
@@ -31,6 +35,187 @@ class _SpecialOpCode(IntEnum):
     ZETA = user_lib.cffi.ZETA
 
 
+# Must match ExprOp in expression.h
+class _ExprOp(IntEnum):
+    CONST = 0
+    ADD = 1
+    SUB = 2
+    MUL = 3
+    DIV = 4
+    NEG = 5
+    EXP = 6
+    LOG = 7
+    SQRT = 8
+    POW = 9
+    ERF = 10
+    LGAMMA = 11
+    TGAMMA = 12
+    DIGAMMA = 13
+    ZETA = 14
+    MAX = 15
+
+
+# Must match the limits in expression.h
+_MAX_EXPR_REGISTERS = 32
+_MAX_EXPR_INSTRUCTIONS = 64
+_MAX_EXPR_CONSTANTS = 16
+_MAX_EXPR_INPUTS = 8
+_MAX_EXPR_OUTPUTS = 4
+
+
+class Expr:
+    """Lazy elementwise expression.
+
+    Built from :func:`expr` leaves with arithmetic operators, the methods below
+    and the functions in this module, then computed in a single pass over
+    memory by :func:`evaluate`.
+    """
+
+    def __init__(
+        self, op: _ExprOp | None, args: Tuple["Expr", ...] = (), value: Any = None
+    ) -> None:
+        self.op = op
+        self.args = args
+        # the array of an input leaf, or the value of a constant
+        self.value = value
+
+    @staticmethod
+    def _wrap(x: Any) -> "Expr":
+        return x if isinstance(x, Expr) else Expr(_ExprOp.CONST, value=float(x))
+
+    def __add__(self, other: Any) -> "Expr":
+        return Expr(_ExprOp.ADD, (self, Expr._wrap(other)))
+
+    def __radd__(self, other: Any) -> "Expr":
+        return Expr(_ExprOp.ADD, (Expr._wrap(other), self))
+
+    def __sub__(self, other: Any) -> "Expr":
+        return Expr(_ExprOp.SUB, (self, Expr._wrap(other)))
+
+    def __rsub__(self, other: Any) -> "Expr":
+        return Expr(_ExprOp.SUB, (Expr._wrap(other), self))
+
+    def __mul__(self, other: Any) -> "Expr":
+        return Expr(_ExprOp.MUL, (self, Expr._wrap(other)))
+
+    def __rmul__(self, other: Any) -> "Expr":
+        return Expr(_ExprOp.MUL, (Expr._wrap(other), self))
+
+    def __truediv__(self, other: Any) -> "Expr":
+        return Expr(_ExprOp.DIV, (self, Expr._wrap(other)))
+
+    def __rtruediv__(self, other: Any) -> "Expr":
+        return Expr(_ExprOp.DIV, (Expr._wrap(other), self))
+
+    def __pow__(self, other: Any) -> "Expr":
+        if other == 2:
+            return Expr(_ExprOp.MUL, (self, self))
+        return Expr(_ExprOp.POW, (self, Expr._wrap(other)))
+
+    def __neg__(self) -> "Expr":
+        return Expr(_ExprOp.NEG, (self,))
+
+    def exp(self) -> "Expr":
+        return Expr(_ExprOp.EXP, (self,))
+
+    def log(self) -> "Expr":
+        return Expr(_ExprOp.LOG, (self,))
+
+    def sqrt(self) -> "Expr":
+        return Expr(_ExprOp.SQRT, (self,))
+
+
+def expr(x: cn.ndarray) -> Expr:
+    """Input leaf of a lazy elementwise expression."""
+    return Expr(None, value=x)
+
+
+def _compile(
+    outputs: Tuple[Expr, ...]
+) -> Tuple[List[cn.ndarray], List[int], List[float], List[int]]:
+    # inputs take the first registers, then one register per node
+    inputs: Dict[int, int] = {}
+    arrays: List[cn.ndarray] = []
+
+    def collect(node: Expr) -> None:
+        if node.op is None and id(node) not in inputs:
+            inputs[id(node)] = len(arrays)
+            arrays.append(node.value)
+        for arg in node.args:
+            collect(arg)
+
+    for o in outputs:
+        collect(o)
+
+    registers = dict(inputs)
+    instructions: List[int] = []
+    constants: List[float] = []
+
+    def visit(node: Expr) -> int:
+        if id(node) in registers:
+            return registers[id(node)]
+        if node.op == _ExprOp.CONST:
+            args = [len(constants), 0]
+            constants.append(node.value)
+        else:
+            args = [visit(arg) for arg in node.args] + [0] * (2 - len(node.args))
+        reg = len(registers)
+        registers[id(node)] = reg
+        instructions.extend([int(node.op), reg] + args)
+        return reg
+
+    out_registers = [visit(o) for o in outputs]
+    if (
+        len(registers) > _MAX_EXPR_REGISTERS
+        or len(instructions) // 4 > _MAX_EXPR_INSTRUCTIONS
+        or len(constants) > _MAX_EXPR_CONSTANTS
+        or len(arrays) > _MAX_EXPR_INPUTS
+        or len(outputs) > _MAX_EXPR_OUTPUTS
+    ):
+        raise ValueError("Expression is too large to evaluate in one task.")
+    return arrays, instructions, constants, out_registers
+
+
+def evaluate(*outputs: Expr) -> Tuple[cn.ndarray, ...]:
+    """Compute one or more lazy expressions in a single task.
+
+    Every element is read once and the whole chain of operations is applied
+    in registers, instead of one task and one temporary array per operation.
+    Inputs must share a shape and are converted to a common floating point
+    type.
+    """
+    arrays, instructions, constants, out_registers = _compile(outputs)
+    if not arrays or not instructions:
+        raise ValueError("Expression must have array inputs and operations.")
+    if any(a.shape != arrays[0].shape for a in arrays):
+        raise ValueError("Expression inputs must have the same shape.")
+    dtype = np.result_type(*[a.dtype for a in arrays])
+    if dtype not in (np.float32, np.float64):
+        dtype = np.float64
+    stores = [get_store(a.astype(dtype, copy=False)) for a in arrays]
+
+    task = get_legate_runtime().create_auto_task(
+        user_context, user_lib.cffi.ELEMENTWISE_EXPR
+    )
+    task.add_scalar_arg(instructions, (ty.int32,))
+    # legate scalars cannot be empty arrays
+    task.add_scalar_arg(constants or [0.0], (ty.float64,))
+    task.add_scalar_arg(out_registers, (ty.int32,))
+    for store in stores:
+        task.add_input(store)
+        task.add_alignment(stores[0], store)
+    results = []
+    for _ in outputs:
+        output = get_legate_runtime().create_store(
+            dtype=stores[0].type, shape=stores[0].shape
+        )
+        task.add_output(output)
+        task.add_alignment(stores[0], output)
+        results.append(output)
+    task.execute()
+    return tuple(cn.array(r, copy=False) for r in results)
+
+
 def _elementwise_fn(x: cn.ndarray, fn: _SpecialOpCode) -> cn.ndarray:
     xs = get_store(x)
     if xs.type not in (ty.float32, ty.float64):
@@ -50,34 +235,49 @@ def _elementwise_fn(x: cn.ndarray, fn: _SpecialOpCode) -> cn.ndarray:
     return cn.array(output)
 
 
-def erf(x: cn.ndarray) -> cn.ndarray:
+def maximum(x: Any, y: Any) -> Expr:
+    """Elementwise maximum of two expressions, propagating NaN."""
+    return Expr(_ExprOp.MAX, (Expr._wrap(x), Expr._wrap(y)))
+
+
+def erf(x: cn.ndarray | Expr) -> Any:
     """Elementwise erf function."""
+    if isinstance(x, Expr):
+        return Expr(_ExprOp.ERF, (x,))
     return _elementwise_fn(x, _SpecialOpCode.ERF)
 
 
-def loggamma(x: cn.ndarray) -> cn.ndarray:
+def loggamma(x: cn.ndarray | Expr) -> Any:
     """Elementwise log-gamma function.
 
     :math:`x` should be greater than 0.
     """
+    if isinstance(x, Expr):
+        return Expr(_ExprOp.LGAMMA, (x,))
     return _elementwise_fn(x, _SpecialOpCode.LGAMMA)
 
 
-def gamma(x: cn.ndarray) -> cn.ndarray:
+def gamma(x: cn.ndarray | Expr) -> Any:
     """Elementwise gamma function."""
+    if isinstance(x, Expr):
+        return Expr(_ExprOp.TGAMMA, (x,))
     return _elementwise_fn(x, _SpecialOpCode.TGAMMA)
 
 
-def digamma(x: cn.ndarray) -> cn.ndarray:
+def digamma(x: cn.ndarray | Expr) -> Any:
     """Elementwise digamma function.
 
     Only real number is supported.
     """
+    if isinstance(x, Expr):
+        return Expr(_ExprOp.DIGAMMA, (x,))
     return _elementwise_fn(x, _SpecialOpCode.DIGAMMA)
 
 
-def zeta(n: int | float, x: cn.ndarray) -> cn.ndarray:
+def zeta(n: int | float, x: cn.ndarray | Expr) -> Any:
     """Riemann zeta function of two arguments."""
+    if isinstance(x, Expr):
+        return Expr(_ExprOp.ZETA, (Expr._wrap(n), x))
     xs = get_store(x)
 
     if xs.type not in (ty.float32, ty.float64):
@@ -98,7 +298,11 @@ def zeta(n: int | float, x: cn.ndarray) -> cn.ndarray:
     return cn.array(output)
 
 
-def polygamma(n: int | float, x: cn.ndarray) -> cn.ndarray:
+def polygamma(n: int | float, x: cn.ndarray | Expr) -> Any:
     """Polygamma functions."""
+    if isinstance(x, Expr):
+        if n == 0:
+            return digamma(x)
+        return (-1.0) ** (n + 1) * math.gamma(n + 1.0) * zeta(n + 1, x)
     fac2 = (-1.0) ** (n + 1) * gamma(cn.asarray([n + 1.0])) * zeta(n + 1, x)
     return cn.where(n == 0, digamma(x), fac2)
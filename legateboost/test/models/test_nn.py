@@ -8,6 +8,8 @@ from sklearn.preprocessing import StandardScaler
 import cunumeric as cn
 import legateboost as lb
 
+from ..utils import force_multi_rank, multi_worker, requires_workers
+
 
 @pytest.mark.parametrize("random_state", [0, 1])
 @pytest.mark.parametrize("hidden_layer_sizes", [(), (100,), (100, 100), (10, 10, 10)])
@@ -96,3 +98,209 @@ def test_alpha(alpha):
             for i in range(len(sklearn_nn.intercepts_))
         )
     )
+
+
+@pytest.mark.parametrize("activation", ["tanh", "relu", "leaky_relu", "silu"])
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_activation(activation, dtype):
+    X, y = fetch_california_housing(return_X_y=True)
+    X = StandardScaler().fit_transform(X[:1000]).astype(dtype)
+    y = y[:1000].astype(dtype)
+    nn = lb.LBRegressor(
+        n_estimators=1,
+        init=None,
+        learning_rate=1.0,
+        base_models=(
+            lb.models.NN(
+                max_iter=200,
+                hidden_layer_sizes=(20, 20),
+                activation=activation,
+            ),
+        ),
+        random_state=0,
+    ).fit(X, y)
+    lb_mse = mean_squared_error(y, nn.predict(X))
+    baseline = mean_squared_error(y, np.full_like(y, y.mean()))
+    assert lb_mse < baseline * 0.5
+
+    if activation in ["tanh", "relu"]:
+        sklearn = MLPRegressor(
+            solver="lbfgs",
+            activation=activation,
+            hidden_layer_sizes=(20, 20),
+            max_iter=200,
+            random_state=0,
+        ).fit(X, y)
+        assert lb_mse < mean_squared_error(y, sklearn.predict(X)) * 1.5
+
+
+def test_unknown_activation():
+    X = cn.array([[1.0], [2.0]])
+    y = cn.array([1.0, 2.0])
+    with pytest.raises(ValueError, match="Unknown activation"):
+        lb.LBRegressor(
+            n_estimators=1,
+            base_models=(lb.models.NN(activation="sigmoid"),),
+        ).fit(X, y)
+
+
+@multi_worker
+@pytest.mark.parametrize("solver", ["adam", "sgd"])
+@pytest.mark.parametrize("allreduce_interval", [1, 4])
+def test_minibatch(solver, allreduce_interval, monkeypatch):
+    force_multi_rank(monkeypatch)
+    X, y = fetch_california_housing(return_X_y=True)
+    X = StandardScaler().fit_transform(X[:1000])
+    y = y[:1000]
+    nn = lb.LBRegressor(
+        n_estimators=1,
+        init=None,
+        learning_rate=1.0,
+        base_models=(
+            lb.models.NN(
+                max_iter=20,
+                hidden_layer_sizes=(20,),
+                solver=solver,
+                batch_size=64,
+                learning_rate_init=1e-2,
+                allreduce_interval=allreduce_interval,
+            ),
+        ),
+        random_state=0,
+    ).fit(X, y)
+    lb_mse = mean_squared_error(y, nn.predict(X))
+    baseline = mean_squared_error(y, np.full_like(y, y.mean()))
+    assert lb_mse < baseline * 0.5
+
+
+@multi_worker
+@requires_workers
+@pytest.mark.parametrize("solver", ["adam", "sgd"])
+def test_minibatch_allreduce_interval(solver, monkeypatch):
+    # Workers step on their own batches between averages, BUILD_NN raises if
+    # their parameters differ once training ends
+    force_multi_rank(monkeypatch)
+    X, y = fetch_california_housing(return_X_y=True)
+    X = StandardScaler().fit_transform(X[:1000])
+    y = y[:1000]
+    # 16 steps per epoch, so the last average comes after the final epoch
+    nn = lb.LBRegressor(
+        n_estimators=1,
+        init=None,
+        learning_rate=1.0,
+        base_models=(
+            lb.models.NN(
+                max_iter=5,
+                hidden_layer_sizes=(20,),
+                solver=solver,
+                batch_size=64,
+                learning_rate_init=1e-2,
+                allreduce_interval=3,
+            ),
+        ),
+        random_state=0,
+    ).fit(X, y)
+    lb_mse = mean_squared_error(y, nn.predict(X))
+    baseline = mean_squared_error(y, np.full_like(y, y.mean()))
+    assert lb_mse < baseline
+
+
+@pytest.mark.parametrize("activation", ["tanh", "relu", "leaky_relu", "silu"])
+@pytest.mark.parametrize("hidden_layer_sizes", [(), (5,), (5, 7)])
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_predict(activation, hidden_layer_sizes, dtype):
+    rs = np.random.RandomState(0)
+    X = cn.array(rs.normal(size=(5000, 4)), dtype=dtype)
+    y = cn.array(rs.normal(size=(5000, 2)), dtype=dtype)
+    nn = lb.LBRegressor(
+        n_estimators=1,
+        base_models=(
+            lb.models.NN(
+                max_iter=5,
+                hidden_layer_sizes=hidden_layer_sizes,
+                activation=activation,
+            ),
+        ),
+        random_state=0,
+    ).fit(X, y)
+    model = nn.models_[0]
+    activations = [X] + [None] * len(hidden_layer_sizes) + [None]
+    expected = model.forward(X, activations)[-1]
+    pred = model.predict(X)
+    assert pred.dtype == dtype
+    assert pred.shape == expected.shape
+    tol = 1e-4 if dtype == np.float32 else 1e-10
+    assert np.allclose(pred, expected, rtol=tol, atol=tol)
+
+
+@pytest.mark.parametrize("activation", ["tanh", "silu"])
+def test_workspace_budget(activation):
+    X, y = fetch_california_housing(return_X_y=True)
+    X = StandardScaler().fit_transform(X[:1000])
+    y = y[:1000]
+    preds = []
+    # A budget this small streams the rows through the network in many blocks
+    for workspace_budget in [None, 40000]:
+        nn = lb.LBRegressor(
+            n_estimators=1,
+            init=None,
+            learning_rate=1.0,
+            base_models=(
+                lb.models.NN(
+                    max_iter=10,
+                    hidden_layer_sizes=(10,),
+                    activation=activation,
+                    workspace_budget=workspace_budget,
+                ),
+            ),
+            random_state=0,
+        ).fit(X, y)
+        preds.append(nn.predict(X))
+    assert np.allclose(preds[0], preds[1], rtol=1e-5, atol=1e-5)
+
+
+@pytest.mark.parametrize("warm_start_noise", [0.0, 0.1])
+def test_warm_start(warm_start_noise):
+    X, y = fetch_california_housing(return_X_y=True)
+    X = StandardScaler().fit_transform(X[:1000])
+    y = y[:1000]
+    mse = []
+    for warm_start in [False, True]:
+        nn = lb.LBRegressor(
+            n_estimators=5,
+            init=None,
+            learning_rate=0.5,
+            base_models=(
+                lb.models.NN(
+                    max_iter=5,
+                    hidden_layer_sizes=(10,),
+                    warm_start=warm_start,
+                    warm_start_noise=warm_start_noise,
+                ),
+            ),
+            random_state=0,
+        ).fit(X, y)
+        mse.append(mean_squared_error(y, nn.predict(X)))
+        # models must not keep the previous round alive
+        assert all(m._previous_model is None for m in nn.models_)
+    # with few iterations per round, continuing from the previous weights helps
+    assert mse[1] < mse[0]
+
+
+def test_warm_start_partial_fit():
+    rng = np.random.RandomState(0)
+    X = rng.normal(size=(200, 3))
+    y = X[:, 0] + X[:, 1] * X[:, 2]
+    model = lb.LBRegressor(
+        n_estimators=3,
+        init=None,
+        base_models=(
+            lb.models.Tree(max_depth=2),
+            lb.models.NN(max_iter=2, hidden_layer_sizes=(4,), warm_start=True),
+        ),
+        random_state=0,
+    )
+    # an odd number of rounds per call, so the next call starts mid-cycle
+    model.partial_fit(X, y)
+    model.partial_fit(X, y)
+    assert [type(m) for m in model.models_] == [lb.models.Tree, lb.models.NN] * 3
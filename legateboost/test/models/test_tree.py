@@ -3,8 +3,10 @@ import pytest
 
 import cunumeric as cn
 import legateboost as lb
+from legateboost.library import user_lib
+from legateboost.utils import get_tunable, task_profiler
 
-from ..utils import non_increasing
+from ..utils import force_multi_rank, multi_worker, non_increasing, requires_workers
 from .utils import check_determinism
 
 
@@ -63,3 +65,231 @@ def test_alpha():
     )
     model.fit(X, y)
     assert model.predict(X)[0] == y.sum() / (y.size + alpha)
+
+
+@multi_worker
+def test_histogram_chunks(monkeypatch):
+    force_multi_rank(monkeypatch)
+    rs = cn.random.RandomState(0)
+    X = cn.array(rs.random((200, 10)))
+    g = cn.array(rs.normal(size=(X.shape[0], 3)))
+    h = cn.array(rs.random(g.shape) + 0.1)
+    models = [
+        lb.models.Tree(max_depth=6, histogram_chunks=histogram_chunks)
+        .set_random_state(np.random.RandomState(2))
+        .fit(X, g, h)
+        for histogram_chunks in [1, 3, 64]
+    ]
+    assert models[0] == models[1]
+    assert models[0] == models[2]
+
+
+def test_tuned_defaults():
+    rs = cn.random.RandomState(0)
+    X = cn.array(rs.random((200, 10)))
+    g = cn.array(rs.normal(size=(X.shape[0], 2)))
+    h = cn.array(rs.random(g.shape) + 0.1)
+    split_samples = get_tunable(user_lib.cffi.TUNABLE_SPLIT_SAMPLES)
+    histogram_chunks = get_tunable(user_lib.cffi.TUNABLE_HISTOGRAM_CHUNKS)
+    assert split_samples > 0 and histogram_chunks > 0
+    # parameters left as None take the mapper's values
+    models = [
+        lb.models.Tree(max_depth=6, **params)
+        .set_random_state(np.random.RandomState(2))
+        .fit(X, g, h)
+        for params in [
+            {},
+            {"split_samples": split_samples, "histogram_chunks": histogram_chunks},
+        ]
+    ]
+    assert models[0] == models[1]
+
+
+@multi_worker
+@pytest.mark.parametrize("offset", [-1, 0])
+def test_single_rank_rows(offset):
+    # inputs below the threshold run as one point task without a communicator
+    n_rows = get_tunable(user_lib.cffi.TUNABLE_SINGLE_RANK_ROWS) + offset
+    rs = cn.random.RandomState(0)
+    X = cn.array(rs.random((n_rows, 4)))
+    g = cn.array(rs.normal(size=(n_rows, 2)))
+    h = cn.array(rs.random(g.shape) + 0.1)
+    model = lb.models.Tree(max_depth=4).set_random_state(np.random.RandomState(2))
+    pred = model.fit_predict(X, g, h)
+    assert cn.allclose(pred, model.predict(X))
+    # refitting the leaves on the same data gives the same predictions
+    assert cn.allclose(pred, model.update(X, g, h).predict(X))
+
+
+@multi_worker
+@requires_workers
+def test_histogram_exchange(monkeypatch):
+    force_multi_rank(monkeypatch)
+    rs = cn.random.RandomState(0)
+    X = cn.array(rs.random((200, 10)))
+    g = cn.array(rs.normal(size=(X.shape[0], 2)))
+    h = cn.array(rs.random(g.shape) + 0.1)
+    models = {}
+    sent = {}
+    for histogram_exchange in ["dense", "auto", "float32"]:
+        task_profiler.collect()
+        with task_profiler.scope():
+            task_profiler.enabled = True
+            models[histogram_exchange] = (
+                lb.models.Tree(max_depth=8, histogram_exchange=histogram_exchange)
+                .set_random_state(np.random.RandomState(2))
+                .fit(X, g, h)
+            )
+            sent[histogram_exchange] = task_profiler.collect()["build_tree"][
+                "bytes_reduced"
+            ]
+    # deep levels have few non-empty bins, so they are sent as sparse pairs
+    assert sent["auto"] < sent["dense"]
+    assert sent["float32"] < sent["auto"]
+
+    dense, sparse, single = models["dense"], models["auto"], models["float32"]
+    # sums over workers may round differently
+    assert cn.all(dense.feature == sparse.feature)
+    assert cn.all(dense.split_value == sparse.split_value)
+    assert cn.allclose(dense.leaf_value, sparse.leaf_value)
+    assert cn.allclose(dense.gain, sparse.gain)
+    assert cn.allclose(dense.hessian, sparse.hessian)
+    assert cn.all(dense.feature == single.feature)
+    assert cn.allclose(dense.leaf_value, single.leaf_value, rtol=1e-4, atol=1e-4)
+
+
+def test_unknown_histogram_exchange():
+    X = cn.array([[0.0], [1.0]])
+    g = cn.array([[0.0], [-1.0]])
+    h = cn.array([[1.0], [1.0]])
+    with pytest.raises(ValueError, match="Unknown histogram_exchange"):
+        lb.models.Tree(histogram_exchange="zstd").set_random_state(
+            np.random.RandomState(0)
+        ).fit(X, g, h)
+
+
+@multi_worker
+def test_partition(monkeypatch):
+    force_multi_rank(monkeypatch)
+    rs = cn.random.RandomState(0)
+    X = cn.array(rs.random((200, 10)))
+    g = cn.array(rs.normal(size=(X.shape[0], 2)))
+    h = cn.array(rs.random(g.shape) + 0.1)
+    a, b = [
+        lb.models.Tree(max_depth=6, partition=partition)
+        .set_random_state(np.random.RandomState(2))
+        .fit(X, g, h)
+        for partition in ["rows", "features"]
+    ]
+    # the same splits, sums over workers may round differently
+    assert cn.all(a.feature == b.feature)
+    assert cn.all(a.split_value == b.split_value)
+    assert cn.allclose(a.leaf_value, b.leaf_value)
+    assert cn.allclose(a.gain, b.gain)
+    assert cn.allclose(a.hessian, b.hessian)
+
+
+@multi_worker
+@requires_workers
+def test_partition_features_small():
+    # wide data below the single rank threshold is still split over workers
+    rs = cn.random.RandomState(0)
+    X = cn.array(rs.random((1000, 400)))
+    g = cn.array(rs.normal(size=(X.shape[0], 1)))
+    h = cn.array(rs.random(g.shape) + 0.1)
+    assert X.shape[0] < get_tunable(user_lib.cffi.TUNABLE_SINGLE_RANK_ROWS)
+    task_profiler.collect()
+    with task_profiler.scope():
+        task_profiler.enabled = True
+        lb.models.Tree(max_depth=4, partition="features").set_random_state(
+            np.random.RandomState(2)
+        ).fit(X, g, h)
+        build_tree = task_profiler.collect()["build_tree"]
+    # every worker reads all rows of its features
+    assert build_tree["rows"] > X.shape[0]
+
+
+def test_invalid_parameters_draw_nothing():
+    X = cn.array([[0.0], [1.0]])
+    g = cn.array([[0.0], [-1.0]])
+    h = cn.array([[1.0], [1.0]])
+    for params in [{"partition": "blocks"}, {"voting_top_k": -1}]:
+        random_state = np.random.RandomState(0)
+        with pytest.raises(ValueError):
+            lb.models.Tree(**params).set_random_state(random_state).fit(X, g, h)
+        # the random state is left as it was
+        assert random_state.randint(0, 2**31) == np.random.RandomState(0).randint(
+            0, 2**31
+        )
+
+
+def test_unknown_partition():
+    X = cn.array([[0.0], [1.0]])
+    g = cn.array([[0.0], [-1.0]])
+    h = cn.array([[1.0], [1.0]])
+    with pytest.raises(ValueError, match="Unknown partition"):
+        lb.models.Tree(partition="blocks").set_random_state(
+            np.random.RandomState(0)
+        ).fit(X, g, h)
+
+
+@multi_worker
+def test_voting(monkeypatch):
+    # voting only runs across several workers
+    force_multi_rank(monkeypatch)
+    rs = cn.random.RandomState(0)
+    X = cn.array(rs.random((200, 20)))
+    g = cn.array(rs.normal(size=(X.shape[0], 2)))
+    h = cn.array(rs.random(g.shape) + 0.1)
+    model = (
+        lb.models.Tree(max_depth=6, voting_top_k=2)
+        .set_random_state(np.random.RandomState(2))
+        .fit(X, g, h)
+    )
+    y = -g / h
+    loss = ((model.predict(X) - y) ** 2 * h).sum() / h.sum()
+    baseline = ((y - (-g.sum(axis=0) / h.sum(axis=0))) ** 2 * h).sum() / h.sum()
+    assert loss < baseline
+
+    with pytest.raises(ValueError, match="voting_top_k requires"):
+        lb.models.Tree(voting_top_k=2, partition="features").set_random_state(
+            np.random.RandomState(0)
+        ).fit(X, g, h)
+
+
+@multi_worker
+@pytest.mark.parametrize("voting_top_k", [4, 20])
+def test_voting_all_features(voting_top_k, monkeypatch):
+    # Only the first 4 of 20 features can split, so with voting_top_k 4 every
+    # worker nominates each of them and voting sums all the histograms that
+    # matter. With voting_top_k 20 voting is skipped altogether.
+    force_multi_rank(monkeypatch)
+    rs = cn.random.RandomState(0)
+    X = cn.zeros((1000, 20))
+    X[:, :4] = rs.random((X.shape[0], 4))
+    g = cn.array(rs.normal(size=(X.shape[0], 2)))
+    h = cn.array(rs.random(g.shape) + 0.1)
+    a, b = [
+        lb.models.Tree(max_depth=4, voting_top_k=k)
+        .set_random_state(np.random.RandomState(2))
+        .fit(X, g, h)
+        for k in [0, voting_top_k]
+    ]
+    assert cn.all(a.feature == b.feature)
+    assert cn.all(a.split_value == b.split_value)
+    assert cn.allclose(a.leaf_value, b.leaf_value)
+    assert cn.allclose(a.gain, b.gain)
+    assert cn.allclose(a.hessian, b.hessian)
+
+
+@pytest.mark.parametrize("max_depth", [0, 1, 6])
+def test_fit_predict(max_depth):
+    rs = cn.random.RandomState(0)
+    X = cn.array(rs.random((200, 10)))
+    g = cn.array(rs.normal(size=(X.shape[0], 3)))
+    h = cn.array(rs.random(g.shape) + 0.1)
+    model = lb.models.Tree(max_depth=max_depth).set_random_state(
+        np.random.RandomState(2)
+    )
+    pred = model.fit_predict(X, g, h)
+    assert cn.all(pred == model.predict(X))
@@ -55,3 +55,48 @@ def test_early_stopping(regression_dataset):
         ValueError, match="Must have at least 1 validation dataset for early stopping."
     ):
         model.partial_fit(X_train, y_train, eval_set=[])
+
+
+def test_phase_profile(regression_dataset):
+    X_train, X_valid, y_train, y_valid = regression_dataset
+    cb = lb.callbacks.PhaseProfile()
+    n_estimators = 3
+    model = lb.LBRegressor(
+        n_estimators=n_estimators,
+        base_models=(lb.models.Tree(max_depth=4),),
+        callbacks=[cb],
+        random_state=1,
+    )
+    model.fit(X_train, y_train, eval_set=[(X_valid, y_valid)])
+    assert len(cb.history) == n_estimators
+    for round_profile in cb.history:
+        build_tree = round_profile["build_tree"]
+        assert build_tree["launches"] == 1
+        assert build_tree["rows"] == X_train.shape[0]
+        assert build_tree["total"] > 0.0
+        assert build_tree["bins"] > 0.0
+        assert round_profile["predict"]["rows"] == X_valid.shape[0]
+
+    # profiling stops with training
+    assert not lb.utils.task_profiler.enabled
+    profiled = model.predict(X_valid)
+    assert lb.utils.task_profiler.collect() == {}
+    assert cn.allclose(profiled, model.predict(X_valid))
+
+
+def test_phase_profile_stops_on_error(regression_dataset):
+    X_train, _, y_train, _ = regression_dataset
+
+    class Failing(lb.callbacks.TrainingCallback):
+        def after_iteration(self, model, epoch, evals_result):
+            raise RuntimeError("callback failed")
+
+    model = lb.LBRegressor(
+        n_estimators=3,
+        base_models=(lb.models.Tree(max_depth=4),),
+        callbacks=[lb.callbacks.PhaseProfile(), Failing()],
+    )
+    with pytest.raises(RuntimeError, match="callback failed"):
+        model.fit(X_train, y_train)
+    assert not lb.utils.task_profiler.enabled
+    lb.utils.task_profiler.collect()
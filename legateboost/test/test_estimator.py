@@ -56,6 +56,63 @@ def test_update(init):
     assert (pred == updated_pred).all()
 
 
+class TraceCountingRuntime:
+    """Records the traces entered, forwarding them and everything else to the
+    legate runtime."""
+
+    def __init__(self, runtime, supports_trace=True):
+        self._runtime = runtime
+        self.begun = []
+        self.ended = []
+        if supports_trace:
+            self.begin_trace = self._begin_trace
+            self.end_trace = self._end_trace
+
+    def _begin_trace(self, trace_id):
+        self.begun.append(trace_id)
+        if hasattr(self._runtime, "begin_trace"):
+            self._runtime.begin_trace(trace_id)
+
+    def _end_trace(self, trace_id):
+        self.ended.append(trace_id)
+        if hasattr(self._runtime, "end_trace"):
+            self._runtime.end_trace(trace_id)
+
+    def __getattr__(self, name):
+        if name in ("begin_trace", "end_trace"):
+            raise AttributeError(name)
+        return getattr(self._runtime, name)
+
+
+def test_trace(monkeypatch):
+    np.random.seed(2)
+    X = np.random.random((100, 10))
+    y = np.random.random(X.shape[0])
+    runtime = TraceCountingRuntime(lb.utils.get_legate_runtime())
+    monkeypatch.setattr(lb.utils, "get_legate_runtime", lambda: runtime)
+    preds = []
+    for trace in [False, True]:
+        model = lb.LBRegressor(
+            n_estimators=6,
+            random_state=0,
+            base_models=(lb.models.Tree(max_depth=3), lb.models.Linear()),
+            trace=trace,
+        ).fit(X, y, eval_set=[(X, y)])
+        preds.append(model.predict(X))
+        # the first round of each base model is not traced
+        expected = [0, 1, 0, 1] if trace else []
+        assert runtime.begun == expected
+        assert runtime.ended == expected
+    assert cn.allclose(preds[0], preds[1])
+
+    # a runtime without tracing warns instead of silently ignoring trace=True
+    runtime = TraceCountingRuntime(runtime._runtime, supports_trace=False)
+    with pytest.warns(RuntimeWarning, match="does not support tracing"):
+        lb.LBRegressor(
+            n_estimators=3, base_models=(lb.models.Tree(max_depth=3),), trace=True
+        ).fit(X, y)
+
+
 @pytest.mark.parametrize("num_outputs", [1, 5])
 @pytest.mark.parametrize("objective", ["squared_error", "normal", "quantile"])
 @pytest.mark.parametrize(
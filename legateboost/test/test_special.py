@@ -133,3 +133,48 @@ def test_trigamma(
     y1 = scipy_polygamma(1, x)
 
     np.testing.assert_allclose(y0, y1, rtol=1e-6)
+
+
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_non_contiguous(dtype: Union[Type[np.float32], Type[np.float64]]) -> None:
+    # strided and transposed views take the accessor path, dense stores the
+    # pointer path
+    from scipy.special import digamma as scipy_digamma
+
+    rng = cn.random.default_rng(1)
+    x = rng.uniform(size=(64, 48), low=0.1, high=20.0).astype(dtype)
+    for view in [x, x[::2, 1::3], x.T, x[3:40, :]]:
+        np.testing.assert_allclose(
+            special.digamma(view), scipy_digamma(view), rtol=1e-5, atol=1e-5
+        )
+
+
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_evaluate(dtype: Union[Type[np.float32], Type[np.float64]]) -> None:
+    from scipy.special import (
+        digamma as scipy_digamma,
+        erf as scipy_erf,
+        polygamma as scipy_polygamma,
+    )
+
+    rng = cn.random.default_rng(1)
+    k = rng.uniform(size=(100, 3), low=0.5, high=5.0).astype(dtype)
+    y = rng.uniform(size=(100, 3), low=0.1, high=4.0).astype(dtype)
+    k_, y_ = special.expr(k), special.expr(y)
+    a, b, c = special.evaluate(
+        k_ * (special.digamma(k_) - y_.log()),
+        special.polygamma(1, k_) * k_**2,
+        special.erf(-y_ / 2.0).exp() + 1,
+    )
+    assert a.dtype == dtype and a.shape == k.shape
+    rtol = 1e-5 if dtype == np.float32 else 1e-10
+    np.testing.assert_allclose(a, k * (scipy_digamma(k) - np.log(y)), rtol=rtol)
+    np.testing.assert_allclose(b, scipy_polygamma(1, k) * k**2, rtol=rtol)
+    np.testing.assert_allclose(c, np.exp(scipy_erf(-y / 2.0)) + 1, rtol=rtol)
+    # strided inputs take the accessor path
+    (d,) = special.evaluate(special.expr(k[::2]) * special.expr(y[1::2]))
+    np.testing.assert_allclose(d, k[::2] * y[1::2], rtol=rtol)
+    (e,) = special.evaluate(special.maximum(k_ - y_, 0.5))
+    np.testing.assert_allclose(e, np.maximum(k - y, 0.5), rtol=rtol)
+    with pytest.raises(ValueError, match="same shape"):
+        special.evaluate(special.expr(k) + special.expr(y[:10]))
@@ -5,6 +5,8 @@ from scipy import optimize
 import cunumeric as cn
 from legateboost.utils import gather, lbfgs, sample_average
 
+from .utils import force_multi_rank, multi_worker
+
 
 def test_sample_average() -> None:
     x = cn.array([1, 2, 3])
@@ -41,8 +43,10 @@ def test_lbfgs():
         assert cn.allclose(result.x, cn.array([1.0, 1.0, 1.0]))
 
 
+@multi_worker
 @pytest.mark.parametrize("dtype", [cn.float32, cn.float64])
-def test_gather(dtype):
+def test_gather(dtype, monkeypatch):
+    force_multi_rank(monkeypatch)
     X = cn.array([[1, 2, 3], [4, 5, 6]], dtype=dtype)
 
     def check_gather(X, rows):
@@ -54,6 +58,7 @@ def test_gather(dtype):
 
     check_gather(X, cn.array([0, 1]))
     check_gather(X, cn.array([1, 0]))
+    check_gather(X, cn.array([1, 1, 0, 1]))
 
     X = cn.array([[1]])
     check_gather(X, cn.array([0]))
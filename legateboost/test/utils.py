@@ -1,7 +1,31 @@
 import numpy as np
+import pytest
 
 import cunumeric as cn
 import legateboost as lb
+import legateboost.utils
+from legate.core import get_legate_runtime
+from legateboost.library import user_lib
+
+# Tests of the paths between workers, CI runs them again with `legate --cpus 2`
+multi_worker = pytest.mark.multi_worker
+# For tests whose assertions only hold with more than one worker
+requires_workers = pytest.mark.skipif(
+    get_legate_runtime().machine.count() < 2, reason="Needs more than one worker"
+)
+
+
+def force_multi_rank(monkeypatch):
+    """Launch tasks over all workers however few rows they have, so small test
+    inputs still go through the collectives between workers."""
+    get_tunable = legateboost.utils.get_tunable
+
+    def no_single_rank(tunable_id):
+        if tunable_id == user_lib.cffi.TUNABLE_SINGLE_RANK_ROWS:
+            return 0
+        return get_tunable(tunable_id)
+
+    monkeypatch.setattr(legateboost.utils, "get_tunable", no_single_rank)
 
 
 def non_increasing(x, tol=1e-3):
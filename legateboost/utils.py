@@ -1,5 +1,8 @@
+import warnings
+from contextlib import contextmanager
 from dataclasses import dataclass
-from typing import Any, Callable, List, Optional, Tuple
+from functools import lru_cache
+from typing import Any, Callable, Dict, Iterator, List, Optional, Tuple
 
 import numpy as np
 
@@ -34,6 +37,125 @@ class PickleCunumericMixin:
         self.__dict__.update(state)
 
 
+@contextmanager
+def runtime_trace(trace_id: int, enabled: bool = True) -> Iterator[None]:
+    """Records the operations issued inside the block as a runtime trace.
+    Dependence analysis and mapping of the first entry with a given id are
+    replayed on later entries, which must issue exactly the same sequence of
+    operations. Does nothing if disabled. Warns and runs the block untraced if
+    the runtime does not support tracing."""
+    runtime = get_legate_runtime()
+    if not enabled:
+        yield
+        return
+    if not hasattr(runtime, "begin_trace"):
+        warnings.warn(
+            "The legate runtime does not support tracing, running untraced.",
+            RuntimeWarning,
+        )
+        yield
+        return
+    runtime.begin_trace(trace_id)
+    try:
+        yield
+    finally:
+        runtime.end_trace(trace_id)
+
+
+@lru_cache
+def get_tunable(tunable_id: int) -> int:
+    """Value chosen by the legateboost mapper for one of the tunables in
+    legateboost.h. Tunables keep fixed defaults unless the environment variable
+    LEGATEBOOST_CALIBRATE is set when the library loads, in which case they are
+    measured for the machine and the first rank's measurement is used."""
+    return int(user_context.get_tunable(tunable_id, types.int32))
+
+
+def single_rank_launch(task: Any, n_rows: int, stores: List[LogicalStore]) -> bool:
+    """Runs a task over fewer than TUNABLE_SINGLE_RANK_ROWS rows as a single
+    point task by broadcasting its row partitioned `stores`. For small inputs
+    partitioning and the collectives between workers cost more than the work
+    they split. Returns True if the task was made single rank, in which case
+    no communicator should be requested. The environment variable
+    LEGATEBOOST_SINGLE_RANK_ROWS overrides the threshold, 0 launches every task
+    over all workers."""
+    if n_rows >= get_tunable(user_lib.cffi.TUNABLE_SINGLE_RANK_ROWS):
+        return False
+    for store in stores:
+        task.add_broadcast(store)
+    return True
+
+
+def add_communicator(task: Any) -> None:
+    """Requests the communicator used by the collectives in cpp_utils."""
+    if get_legate_runtime().machine.count(TaskTarget.GPU) > 1:
+        task.add_nccl_communicator()
+    elif get_legate_runtime().machine.count() > 1:
+        task.add_cpu_communicator()
+
+
+# Must match ProfileField in cpp_utils.h
+PROFILE_FIELDS = (
+    "split_proposals",
+    "histogram",
+    "allreduce",
+    "scan",
+    "split_evaluation",
+    "update_positions",
+    "total",
+    "rows",
+    "bins",
+    "bytes_reduced",
+)
+
+
+class TaskProfiler:
+    """Collects the phase timers and counters of native tasks. While enabled,
+    each instrumented task gets a small reduction store that its points sum
+    PROFILE_FIELDS into. Times are in seconds, summed over points. Disabled
+    tasks get no store and record nothing."""
+
+    def __init__(self) -> None:
+        self.enabled = False
+        self._pending: List[Tuple[str, cn.ndarray]] = []
+
+    def add_to(self, task: Any, name: str) -> None:
+        """Adds a profile store to `task`, after its other reductions."""
+        if not self.enabled:
+            return
+        profile = cn.zeros(len(PROFILE_FIELDS))
+        task.add_reduction(get_store(profile), types.ReductionOpKind.ADD)
+        task.add_broadcast(get_store(profile))
+        self._pending.append((name, profile))
+
+    def collect(self) -> Dict[str, Dict[str, float]]:
+        """Sums the profiles of the tasks launched since the last call by task
+        name, with the number of launches. Waits for those tasks to finish."""
+        result: Dict[str, Dict[str, float]] = {}
+        for name, profile in self._pending:
+            totals = result.setdefault(
+                name, dict.fromkeys(PROFILE_FIELDS + ("launches",), 0.0)
+            )
+            for field, value in zip(PROFILE_FIELDS, profile.tolist()):
+                totals[field] += value
+            totals["launches"] += 1
+        self._pending = []
+        return result
+
+    @contextmanager
+    def scope(self) -> Iterator[None]:
+        """Restores the enabled state on leaving the block, also when it
+        raises, so a failed training run does not leave profiling on."""
+        enabled = self.enabled
+        try:
+            yield
+        finally:
+            self.enabled = enabled
+
+
+task_profiler = TaskProfiler()
+
+
 def pick_col_by_idx(a: cn.ndarray, b: cn.ndarray) -> cn.ndarray:
     """Alternative implementation for a[cn.arange(b.size), b]"""
 
@@ -387,10 +509,9 @@ def gather_from_array(X: cn.array, samples: cn.array) -> cn.array:
     task.add_output(get_store(output))
     task.add_broadcast(get_store(output))
 
-    if get_legate_runtime().machine.count(TaskTarget.GPU) > 1:
-        task.add_nccl_communicator()
-    elif get_legate_runtime().machine.count() > 1:
-        task.add_cpu_communicator()
+    if not single_rank_launch(task, X.shape[0], [get_store(X)]):
+        add_communicator(task)
+    task_profiler.add_to(task, "gather")
 
     task.execute()
     return output
@@ -413,10 +534,9 @@ def gather(X: cn.array, samples: Tuple[int, ...]) -> cn.array:
     task.add_output(get_store(output))
     task.add_broadcast(get_store(output))
 
-    if get_legate_runtime().machine.count(TaskTarget.GPU) > 1:
-        task.add_nccl_communicator()
-    elif get_legate_runtime().machine.count() > 1:
-        task.add_cpu_communicator()
+    if not single_rank_launch(task, X.shape[0], [get_store(X)]):
+        add_communicator(task)
+    task_profiler.add_to(task, "gather")
 
     task.execute()
     return output
@@ -0,0 +1,406 @@
+/* Copyright 2024 NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "legate.h"
+#include "legateboost.h"
+#include "estimator.h"
+#include "../cpp_utils/cpp_utils.h"
+#include "../special/expression.h"
+#include <limits>
+#include <utility>
+
+namespace legateboost {
+
+namespace {
+
+legate::Library GetLibrary()
+{
+  return legate::Runtime::get_runtime()->find_library("legateboost");
+}
+
+legate::LogicalStore CreateStore(const legate::Type& type, std::initializer_list<uint64_t> extents)
+{
+  return legate::Runtime::get_runtime()->create_store(legate::Shape{extents}, type);
+}
+
+// As get_tunable in utils.py, the mapper's values are fixed for the life of the process
+int32_t GetTunable(LegateBoostTunable tunable)
+{
+  return GetLibrary().get_tunable(tunable, legate::int32()).value<int32_t>();
+}
+
+int32_t SingleRankRows()
+{
+  static const int32_t rows = GetTunable(TUNABLE_SINGLE_RANK_ROWS);
+  return rows;
+}
+
+int32_t SplitSamples(const TreeParams& params)
+{
+  static const int32_t split_samples = GetTunable(TUNABLE_SPLIT_SAMPLES);
+  return params.split_samples.value_or(split_samples);
+}
+
+int32_t HistogramChunks(const TreeParams& params)
+{
+  static const int32_t histogram_chunks = GetTunable(TUNABLE_HISTOGRAM_CHUNKS);
+  return params.histogram_chunks.value_or(histogram_chunks);
+}
+
+// As single_rank_launch in utils.py, broadcasts the row partitioned stores of a task over few rows
+// so it runs as one point task. Returns true if so, the task then needs no communicator.
+bool SingleRankLaunch(legate::AutoTask& task,
+                      uint64_t rows,
+                      std::initializer_list<legate::Variable> row_stores)
+{
+  if (rows >= static_cast<uint64_t>(SingleRankRows())) return false;
+  for (const auto& store : row_stores) { task.add_constraint(legate::broadcast(store)); }
+  return true;
+}
+
+// Same communicators as the Python models request
+void AddCommunicator(legate::AutoTask& task)
+{
+  auto machine = legate::Runtime::get_runtime()->get_machine();
+  if (machine.count(legate::mapping::TaskTarget::GPU) > 1) {
+    task.add_communicator("nccl");
+  } else if (machine.count() > 1) {
+    task.add_communicator("cpu");
+  }
+}
+
+// Assembles a program for ELEMENTWISE_EXPR, see _compile in special.py
+// Registers [0, num_inputs) hold the inputs, every op writes a new register
+class Expr {
+ public:
+  explicit Expr(int num_inputs) : num_inputs(num_inputs), next_register(num_inputs) {}
+
+  int Const(double value)
+  {
+    constants.push_back(value);
+    return Op(ExprOp::kConst, constants.size() - 1);
+  }
+  int Op(ExprOp op, int a, int b = 0)
+  {
+    EXPECT(next_register < kMaxExprRegisters, "Expression too long.");
+    instructions.insert(instructions.end(), {static_cast<int32_t>(op), next_register, a, b});
+    return next_register++;
+  }
+  int Sigmoid(int x)
+  {
+    int one = Const(1.0);
+    return Op(ExprOp::kDiv, one, Op(ExprOp::kAdd, one, Op(ExprOp::kExp, Op(ExprOp::kNeg, x))));
+  }
+
+  // Returns a float64 store for each output register, shaped like the inputs
+  std::vector<legate::LogicalStore> Evaluate(const std::vector<legate::LogicalStore>& inputs,
+                                             const std::vector<int32_t>& outputs) const
+  {
+    EXPECT(static_cast<int>(inputs.size()) == num_inputs,
+           "Expression inputs do not match the program.");
+    auto runtime = legate::Runtime::get_runtime();
+    auto task    = runtime->create_task(GetLibrary(), ELEMENTWISE_EXPR);
+    task.add_scalar_arg(legate::Scalar(instructions));
+    // legate scalars cannot be empty arrays
+    task.add_scalar_arg(
+      legate::Scalar(constants.empty() ? std::vector<double>{0.0} : constants));
+    task.add_scalar_arg(legate::Scalar(outputs));
+    auto first = task.add_input(inputs[0]);
+    for (size_t i = 1; i < inputs.size(); i++) {
+      task.add_constraint(legate::align(first, task.add_input(inputs[i])));
+    }
+    std::vector<legate::LogicalStore> results;
+    for (size_t i = 0; i < outputs.size(); i++) {
+      results.push_back(runtime->create_store(inputs[0].extents(), legate::float64()));
+      task.add_constraint(legate::align(first, task.add_output(results.back())));
+    }
+    runtime->submit(std::move(task));
+    return results;
+  }
+
+ private:
+  int num_inputs;
+  int32_t next_register;
+  std::vector<int32_t> instructions;
+  std::vector<double> constants;
+};
+
+legate::LogicalStore Add(const legate::LogicalStore& a, const legate::LogicalStore& b)
+{
+  Expr e(2);
+  return e.Evaluate({a, b}, {e.Op(ExprOp::kAdd, 0, 1)})[0];
+}
+
+// Gradient and hessian of the objective at pred
+// As LBBase._get_weighted_gradient, the gradient is scaled by the learning rate
+std::pair<legate::LogicalStore, legate::LogicalStore> Gradient(Objective objective,
+                                                              double learning_rate,
+                                                              const legate::LogicalStore& y,
+                                                              const legate::LogicalStore& pred)
+{
+  Expr e(2);  // y, pred
+  int g, h;
+  if (objective == Objective::kSquaredError) {
+    g = e.Op(ExprOp::kSub, 1, 0);
+    h = e.Const(1.0);
+  } else {
+    int p = e.Sigmoid(1);
+    g     = e.Op(ExprOp::kSub, p, 0);
+    h     = e.Op(ExprOp::kMul, p, e.Op(ExprOp::kSub, e.Const(1.0), p));
+  }
+  g              = e.Op(ExprOp::kMul, g, e.Const(learning_rate));
+  auto gradients = e.Evaluate({y, pred}, {g, h});
+  return {gradients[0], gradients[1]};
+}
+
+// Launches BUILD_TREE as Tree.fit, if train_pred is given it receives the predictions for X
+TreeModel FitTree(const TreeParams& params,
+                  int32_t seed,
+                  const legate::LogicalStore& X,
+                  const legate::LogicalStore& g,
+                  const legate::LogicalStore& h,
+                  const legate::LogicalStore* train_pred)
+{
+  auto runtime       = legate::Runtime::get_runtime();
+  auto num_features  = X.extents()[1];
+  auto num_outputs   = g.extents()[1];
+  uint64_t max_nodes = uint64_t(1) << (params.max_depth + 1);
+  auto task          = runtime->create_task(GetLibrary(), BUILD_TREE);
+  task.add_scalar_arg(legate::Scalar(params.max_depth));
+  task.add_scalar_arg(legate::Scalar(static_cast<int32_t>(max_nodes)));
+  task.add_scalar_arg(legate::Scalar(params.alpha));
+  task.add_scalar_arg(legate::Scalar(SplitSamples(params)));
+  task.add_scalar_arg(legate::Scalar(seed));
+  task.add_scalar_arg(legate::Scalar(static_cast<int64_t>(X.extents()[0])));
+  task.add_scalar_arg(legate::Scalar(HistogramChunks(params)));
+  task.add_scalar_arg(legate::Scalar(params.histogram_exchange));
+  task.add_scalar_arg(legate::Scalar(false));  // feature_parallel
+  task.add_scalar_arg(legate::Scalar(params.voting_top_k));
+
+  auto X_ = task.add_input(X.promote(2, num_outputs));
+  task.add_constraint(legate::broadcast(X_, {1}));
+  auto g_ = task.add_input(g.promote(1, num_features));
+  auto h_ = task.add_input(h.promote(1, num_features));
+  task.add_constraint(legate::align(g_, h_));
+  task.add_constraint(legate::align(g_, X_));
+
+  TreeModel tree{CreateStore(legate::float64(), {max_nodes, num_outputs}),
+                 CreateStore(legate::int32(), {max_nodes}),
+                 CreateStore(legate::float64(), {max_nodes}),
+                 CreateStore(legate::float64(), {max_nodes}),
+                 CreateStore(legate::float64(), {max_nodes, num_outputs})};
+  for (const auto& store :
+       {tree.leaf_value, tree.feature, tree.split_value, tree.gain, tree.hessian}) {
+    task.add_constraint(legate::broadcast(task.add_output(store)));
+  }
+  bool single_rank = false;
+  if (train_pred != nullptr) {
+    auto pred_ = task.add_output(train_pred->promote(1, num_features));
+    task.add_constraint(legate::align(g_, pred_));
+    single_rank = SingleRankLaunch(task, X.extents()[0], {X_, g_, h_, pred_});
+  } else {
+    single_rank = SingleRankLaunch(task, X.extents()[0], {X_, g_, h_});
+  }
+  if (!single_rank) AddCommunicator(task);
+  runtime->submit(std::move(task));
+  return tree;
+}
+
+legate::LogicalStore PredictTree(const TreeModel& tree, const legate::LogicalStore& X)
+{
+  auto runtime      = legate::Runtime::get_runtime();
+  auto num_features = X.extents()[1];
+  auto num_outputs  = tree.leaf_value.extents()[1];
+  auto pred         = CreateStore(legate::float64(), {X.extents()[0], num_outputs});
+  auto task         = runtime->create_task(GetLibrary(), PREDICT);
+  auto X_           = task.add_input(X.promote(2, num_outputs));
+  task.add_constraint(legate::broadcast(X_, {1}));
+  for (const auto& store : {tree.leaf_value, tree.feature, tree.split_value}) {
+    task.add_constraint(legate::broadcast(task.add_input(store)));
+  }
+  auto pred_ = task.add_output(pred.promote(1, num_features));
+  task.add_constraint(legate::align(X_, pred_));
+  SingleRankLaunch(task, X.extents()[0], {X_, pred_});
+  runtime->submit(std::move(task));
+  return pred;
+}
+
+// Launches UPDATE_TREE as Tree.update, node statistics are summed with reduction privileges
+void UpdateTree(TreeModel& tree,
+                double alpha,
+                const legate::LogicalStore& X,
+                const legate::LogicalStore& g,
+                const legate::LogicalStore& h)
+{
+  auto runtime      = legate::Runtime::get_runtime();
+  auto num_features = X.extents()[1];
+  auto num_nodes    = tree.leaf_value.extents()[0];
+  auto num_outputs  = tree.leaf_value.extents()[1];
+  auto task         = runtime->create_task(GetLibrary(), UPDATE_TREE);
+  auto X_           = task.add_input(X.promote(2, num_outputs));
+  task.add_constraint(legate::broadcast(X_, {1}));
+  auto g_ = task.add_input(g.promote(1, num_features));
+  auto h_ = task.add_input(h.promote(1, num_features));
+  task.add_constraint(legate::align(g_, h_));
+  task.add_constraint(legate::align(g_, X_));
+  task.add_constraint(legate::broadcast(task.add_input(tree.feature)));
+  task.add_constraint(legate::broadcast(task.add_input(tree.split_value)));
+
+  auto gradient = CreateStore(legate::float64(), {num_nodes, num_outputs});
+  auto hessian  = CreateStore(legate::float64(), {num_nodes, num_outputs});
+  for (const auto& stats : {gradient, hessian}) {
+    runtime->issue_fill(stats, legate::Scalar(0.0));
+    task.add_constraint(
+      legate::broadcast(task.add_reduction(stats, legate::ReductionOpKind::ADD)));
+  }
+  SingleRankLaunch(task, X.extents()[0], {X_, g_, h_});
+  runtime->submit(std::move(task));
+
+  // Must match CalculateLeafValue in build_tree.h
+  // Nodes without rows have zero gradient and hessian, so alpha > 0 keeps their value at zero
+  Expr e(2);
+  int leaf = e.Op(ExprOp::kDiv, e.Op(ExprOp::kNeg, 0), e.Op(ExprOp::kAdd, 1, e.Const(alpha)));
+  tree.leaf_value = e.Evaluate({gradient, hessian}, {leaf})[0];
+  tree.hessian    = hessian;
+}
+
+}  // namespace
+
+LBBase::LBBase(Objective objective, const LBParams& params)
+  : objective_(objective), params_(params), rng_(params.random_state)
+{
+  EXPECT(params.n_estimators >= 0, "n_estimators must not be negative.");
+  EXPECT(params.tree.max_depth >= 0 && params.tree.max_depth < 30,
+         "max_depth must be in [0, 30).");
+  EXPECT(params.tree.histogram_chunks.value_or(1) >= 1, "histogram_chunks must be at least 1.");
+  EXPECT(params.tree.voting_top_k >= 0, "voting_top_k must not be negative.");
+}
+
+void LBBase::CheckInput(const legate::LogicalStore& X, const legate::LogicalStore& y) const
+{
+  EXPECT(X.dim() == 2 && y.dim() == 2, "Expected 2 dimensional X and y.");
+  EXPECT(X.extents()[0] == y.extents()[0], "X and y must have the same number of rows.");
+  auto X_code = X.type().code();
+  EXPECT(X_code == legate::Type::Code::FLOAT32 || X_code == legate::Type::Code::FLOAT64,
+         "X must be float32 or float64.");
+  EXPECT(y.type().code() == legate::Type::Code::FLOAT64, "y must be float64.");
+  EXPECT(objective_ != Objective::kLogLoss || y.extents()[1] == 1,
+         "Only binary classification with labels in a single column is supported.");
+  if (n_features_ > 0) {
+    EXPECT(X.extents()[1] == n_features_ && y.extents()[1] == n_outputs_,
+           "X and y must have as many columns as during the first fit.");
+  }
+}
+
+// The initial prediction is fitted as a tree of depth 0 on the squared error gradient at zero,
+// whose leaf is the mean of y. This keeps the reduction over rows inside BUILD_TREE.
+void LBBase::FitInit(const legate::LogicalStore& X, const legate::LogicalStore& y)
+{
+  if (!params_.init_average) {
+    init_.reset();
+    return;
+  }
+  Expr e(1);  // y
+  auto gradients = e.Evaluate({y}, {e.Op(ExprOp::kNeg, 0), e.Const(1.0)});
+  TreeParams params;
+  params.max_depth     = 0;
+  params.alpha         = 0.0;
+  params.split_samples = 1;
+  init_                = FitTree(params, 0, X, gradients[0], gradients[1], nullptr);
+}
+
+legate::LogicalStore LBBase::InitPrediction(const legate::LogicalStore& X) const
+{
+  if (!init_) {
+    auto pred = CreateStore(legate::float64(), {X.extents()[0], n_outputs_});
+    legate::Runtime::get_runtime()->issue_fill(pred, legate::Scalar(0.0));
+    return pred;
+  }
+  auto mean = PredictTree(*init_, X);
+  if (objective_ == Objective::kSquaredError) return mean;
+  // Log odds of the mean label, as LogLossObjective.initialise_prediction
+  Expr e(1);  // mean
+  int one   = e.Const(1.0);
+  int odds  = e.Op(ExprOp::kSub, e.Op(ExprOp::kDiv, one, 0), one);  // 1 / p - 1
+  int logit = e.Op(ExprOp::kNeg, e.Op(ExprOp::kLog, odds));
+  return e.Evaluate({mean}, {logit})[0];
+}
+
+LBBase& LBBase::Fit(const legate::LogicalStore& X, const legate::LogicalStore& y)
+{
+  n_features_ = 0;
+  n_outputs_  = 0;
+  init_.reset();
+  models_.clear();
+  rng_.seed(params_.random_state);
+  return PartialFit(X, y);
+}
+
+LBBase& LBBase::PartialFit(const legate::LogicalStore& X, const legate::LogicalStore& y)
+{
+  CheckInput(X, y);
+  if (n_features_ == 0) {
+    n_features_ = X.extents()[1];
+    n_outputs_  = y.extents()[1];
+    FitInit(X, y);
+  }
+
+  auto pred = PredictRaw(X);
+  std::uniform_int_distribution<int32_t> seeds(0, std::numeric_limits<int32_t>::max());
+  for (int32_t i = 0; i < params_.n_estimators; i++) {
+    auto [g, h] = Gradient(objective_, params_.learning_rate, y, pred);
+    // BUILD_TREE predicts the training rows, except in the last round where they are unused
+    std::optional<legate::LogicalStore> delta;
+    if (i + 1 < params_.n_estimators) {
+      delta = CreateStore(legate::float64(), {X.extents()[0], n_outputs_});
+    }
+    models_.push_back(FitTree(params_.tree, seeds(rng_), X, g, h, delta ? &*delta : nullptr));
+    if (delta) pred = Add(pred, *delta);
+  }
+  return *this;
+}
+
+LBBase& LBBase::Update(const legate::LogicalStore& X, const legate::LogicalStore& y)
+{
+  EXPECT(n_features_ > 0, "Update requires a fitted model.");
+  EXPECT(params_.tree.alpha > 0.0, "Update requires alpha > 0.");
+  CheckInput(X, y);
+  FitInit(X, y);
+  auto pred = InitPrediction(X);
+  for (size_t i = 0; i < models_.size(); i++) {
+    auto [g, h] = Gradient(objective_, params_.learning_rate, y, pred);
+    UpdateTree(models_[i], params_.tree.alpha, X, g, h);
+    if (i + 1 < models_.size()) pred = Add(pred, PredictTree(models_[i], X));
+  }
+  return *this;
+}
+
+legate::LogicalStore LBBase::PredictRaw(const legate::LogicalStore& X) const
+{
+  EXPECT(n_features_ > 0, "Predict requires a fitted model.");
+  EXPECT(X.dim() == 2 && X.extents()[1] == n_features_,
+         "X must have as many columns as during fit.");
+  auto pred = InitPrediction(X);
+  for (const auto& tree : models_) { pred = Add(pred, PredictTree(tree, X)); }
+  return pred;
+}
+
+legate::LogicalStore LBClassifier::PredictProba(const legate::LogicalStore& X) const
+{
+  Expr e(1);  // raw prediction
+  return e.Evaluate({PredictRaw(X)}, {e.Sigmoid(0)})[0];
+}
+
+}  // namespace legateboost
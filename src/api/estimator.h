@@ -0,0 +1,114 @@
+/* Copyright 2024 NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+#include "legate.h"
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+// Registers the legateboost tasks with a running legate runtime
+// Python does this on import, C++ programs call it once after legate::start
+extern "C" void legateboost_perform_registration(void);
+
+namespace legateboost {
+
+// C++ counterpart of LBRegressor and LBClassifier for programs that train without Python
+// Data and predictions are legate stores: X is [rows, features] of float32 or float64, y and
+// predictions are [rows, outputs] of float64. Each round fits a Tree with BUILD_TREE, the
+// objective runs in ELEMENTWISE_EXPR tasks.
+
+// Must match the parameters of legateboost.models.Tree, partition is always 'rows'
+// Unset split_samples and histogram_chunks take the mapper's tunables, as None does in Python
+struct TreeParams {
+  int32_t max_depth = 8;
+  std::optional<int32_t> split_samples;
+  double alpha = 1.0;
+  std::optional<int32_t> histogram_chunks;
+  int32_t histogram_exchange = 1;  // HistogramExchange in build_tree.h
+  int32_t voting_top_k       = 0;
+};
+
+struct LBParams {
+  int32_t n_estimators  = 100;
+  double learning_rate  = 0.1;
+  bool init_average     = true;  // init='average', otherwise boost from zero
+  uint32_t random_state = 0;
+  TreeParams tree;
+};
+
+// The broadcast stores of a fitted tree, as the attributes of the Python Tree
+struct TreeModel {
+  legate::LogicalStore leaf_value;
+  legate::LogicalStore feature;
+  legate::LogicalStore split_value;
+  legate::LogicalStore gain;
+  legate::LogicalStore hessian;
+};
+
+enum class Objective : int32_t {
+  kSquaredError = 0,
+  kLogLoss      = 1,  // binary, labels are 0 or 1
+};
+
+class LBBase {
+ public:
+  LBBase(Objective objective, const LBParams& params);
+
+  // Discards any previous models and trains params.n_estimators rounds
+  LBBase& Fit(const legate::LogicalStore& X, const legate::LogicalStore& y);
+  // Trains params.n_estimators more rounds on top of the existing models
+  LBBase& PartialFit(const legate::LogicalStore& X, const legate::LogicalStore& y);
+  // Keeps the structure of every tree and refits the leaf values on new data
+  LBBase& Update(const legate::LogicalStore& X, const legate::LogicalStore& y);
+  // Untransformed predictions, [rows, outputs]
+  legate::LogicalStore PredictRaw(const legate::LogicalStore& X) const;
+
+  const std::vector<TreeModel>& Models() const { return models_; }
+  const LBParams& Params() const { return params_; }
+
+ private:
+  void CheckInput(const legate::LogicalStore& X, const legate::LogicalStore& y) const;
+  void FitInit(const legate::LogicalStore& X, const legate::LogicalStore& y);
+  legate::LogicalStore InitPrediction(const legate::LogicalStore& X) const;
+
+  Objective objective_;
+  LBParams params_;
+  std::mt19937 rng_;
+  uint64_t n_features_ = 0;
+  uint64_t n_outputs_  = 0;
+  // The initial prediction is a tree of depth 0, absent if not boosting from the average
+  std::optional<TreeModel> init_;
+  std::vector<TreeModel> models_;
+};
+
+class LBRegressor : public LBBase {
+ public:
+  explicit LBRegressor(const LBParams& params = {}) : LBBase(Objective::kSquaredError, params) {}
+
+  legate::LogicalStore Predict(const legate::LogicalStore& X) const { return PredictRaw(X); }
+};
+
+// Binary classification only, y holds 0 or 1 in a single column
+class LBClassifier : public LBBase {
+ public:
+  explicit LBClassifier(const LBParams& params = {}) : LBBase(Objective::kLogLoss, params) {}
+
+  // Probability of the positive class, [rows, 1]
+  legate::LogicalStore PredictProba(const legate::LogicalStore& X) const;
+};
+
+}  // namespace legateboost
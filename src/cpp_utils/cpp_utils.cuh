@@ -74,22 +74,211 @@ void SumAllReduce(legate::TaskContext context, T* x, int count, cudaStream_t str
   size_t num_ranks = domain.get_volume();
   EXPECT(num_ranks == 1 || context.num_communicators() > 0,
          "Expected a GPU communicator for multi-rank task.");
-  if (context.num_communicators() == 0) return;
+  if (num_ranks == 1 || context.num_communicators() == 0) return;
   auto comm             = context.communicator(0);
   ncclComm_t* nccl_comm = comm.get<ncclComm_t*>();
 
-  if (num_ranks > 1) {
-    if (std::is_same<T, float>::value) {
-      CHECK_NCCL(ncclAllReduce(x, x, count, ncclFloat, ncclSum, *nccl_comm, stream));
-    } else if (std::is_same<T, double>::value) {
-      CHECK_NCCL(ncclAllReduce(x, x, count, ncclDouble, ncclSum, *nccl_comm, stream));
-    } else {
-      EXPECT(false, "Unsupported type for all reduce.");
-    }
+  if (std::is_same<T, float>::value) {
+    CHECK_NCCL(ncclAllReduce(x, x, count, ncclFloat, ncclSum, *nccl_comm, stream));
+  } else if (std::is_same<T, double>::value) {
+    CHECK_NCCL(ncclAllReduce(x, x, count, ncclDouble, ncclSum, *nccl_comm, stream));
+  } else {
+    EXPECT(false, "Unsupported type for all reduce.");
+  }
+  CHECK_CUDA_STREAM(stream);
+}
+
+/**
+ * @brief Device version of AllGatherRows. `rows`, `positions` and `out` are device pointers.
+ */
+template <typename T>
+void AllGatherRows(legate::TaskContext context,
+                   const T* rows,
+                   const int32_t* positions,
+                   int32_t count,
+                   int64_t n_cols,
+                   T* out,
+                   cudaStream_t stream)
+{
+  auto domain      = context.get_launch_domain();
+  size_t num_ranks = domain.get_volume();
+  EXPECT(num_ranks == 1 || context.num_communicators() > 0,
+         "Expected a GPU communicator for multi-rank task.");
+  if (num_ranks == 1 || context.num_communicators() == 0) {
+    LaunchN(count * n_cols, stream, [=] __device__(auto idx) {
+      out[positions[idx / n_cols] * n_cols + idx % n_cols] = rows[idx];
+    });
     CHECK_CUDA_STREAM(stream);
+    return;
   }
+  ncclDataType_t type;
+  if (std::is_same<T, float>::value)
+    type = ncclFloat;
+  else if (std::is_same<T, double>::value)
+    type = ncclDouble;
+  else
+    EXPECT(false, "Unsupported type for all gather.");
+  auto comm             = context.communicator(0);
+  ncclComm_t* nccl_comm = comm.get<ncclComm_t*>();
+
+  auto send_count  = legate::create_buffer<int32_t, 1>(1);
+  auto recv_counts = legate::create_buffer<int32_t, 1>(num_ranks);
+  CHECK_CUDA(cudaMemcpyAsync(
+    send_count.ptr(0), &count, sizeof(int32_t), cudaMemcpyHostToDevice, stream));
+  CHECK_NCCL(
+    ncclAllGather(send_count.ptr(0), recv_counts.ptr(0), 1, ncclInt32, *nccl_comm, stream));
+  std::vector<int32_t> counts(num_ranks);
+  CHECK_CUDA(cudaMemcpyAsync(counts.data(),
+                             recv_counts.ptr(0),
+                             num_ranks * sizeof(int32_t),
+                             cudaMemcpyDeviceToHost,
+                             stream));
+  CHECK_CUDA(cudaStreamSynchronize(stream));
+  int32_t max_count = *std::max_element(counts.begin(), counts.end());
+  if (max_count == 0) return;
+
+  // The send buffers are padded to max_count, the padding is never read
+  auto send_positions = legate::create_buffer<int32_t, 1>(max_count);
+  auto recv_positions = legate::create_buffer<int32_t, 1>(max_count * num_ranks);
+  auto send_rows      = legate::create_buffer<T, 1>(max_count * n_cols);
+  auto recv_rows      = legate::create_buffer<T, 1>(max_count * n_cols * num_ranks);
+  CHECK_CUDA(cudaMemcpyAsync(send_positions.ptr(0),
+                             positions,
+                             count * sizeof(int32_t),
+                             cudaMemcpyDeviceToDevice,
+                             stream));
+  CHECK_CUDA(cudaMemcpyAsync(
+    send_rows.ptr(0), rows, count * n_cols * sizeof(T), cudaMemcpyDeviceToDevice, stream));
+  CHECK_NCCL(ncclGroupStart());
+  CHECK_NCCL(ncclAllGather(
+    send_positions.ptr(0), recv_positions.ptr(0), max_count, ncclInt32, *nccl_comm, stream));
+  CHECK_NCCL(ncclAllGather(
+    send_rows.ptr(0), recv_rows.ptr(0), max_count * n_cols, type, *nccl_comm, stream));
+  CHECK_NCCL(ncclGroupEnd());
+
+  auto recv_counts_ptr    = recv_counts.ptr(0);
+  auto recv_positions_ptr = recv_positions.ptr(0);
+  auto recv_rows_ptr      = recv_rows.ptr(0);
+  LaunchN(max_count * n_cols * num_ranks, stream, [=] __device__(auto idx) {
+    auto r = idx / (max_count * n_cols);
+    auto i = (idx / n_cols) % max_count;
+    if (i >= recv_counts_ptr[r]) return;
+    out[recv_positions_ptr[r * max_count + i] * n_cols + idx % n_cols] = recv_rows_ptr[idx];
+  });
+  CHECK_CUDA_STREAM(stream);
+}
+
+/**
+ * @brief Device version of OrAllReduce.
+ */
+inline void OrAllReduce(legate::TaskContext context, uint32_t* x, int count, cudaStream_t stream)
+{
+  auto domain      = context.get_launch_domain();
+  size_t num_ranks = domain.get_volume();
+  EXPECT(num_ranks == 1 || context.num_communicators() > 0,
+         "Expected a GPU communicator for multi-rank task.");
+  if (count == 0 || num_ranks == 1 || context.num_communicators() == 0) return;
+  auto comm             = context.communicator(0);
+  ncclComm_t* nccl_comm = comm.get<ncclComm_t*>();
+  auto recvbuf          = legate::create_buffer<uint32_t, 1>(count * num_ranks);
+  auto recvbuf_ptr      = recvbuf.ptr(0);
+  CHECK_NCCL(ncclAllGather(x, recvbuf_ptr, count, ncclUint32, *nccl_comm, stream));
+  LaunchN(count, stream, [=] __device__(auto i) {
+    uint32_t word = 0;
+    for (size_t r = 0; r < num_ranks; r++) { word |= recvbuf_ptr[r * count + i]; }
+    x[i] = word;
+  });
+  CHECK_CUDA_STREAM(stream);
 }
 
+/**
+ * @brief Times work queued on CUDA streams for a TaskProfile.
+ *
+ * Intervals are bounded by events recorded on the stream the work runs on, so profiling neither
+ * synchronises the host nor serialises streams that overlap. They are added to the profile when it
+ * is written.
+ */
+class StreamProfile {
+ public:
+  explicit StreamProfile(TaskProfile& profile) : profile(profile) {}
+  ~StreamProfile()
+  {
+    for (auto& interval : intervals) {
+      cudaEventDestroy(interval.begin);
+      cudaEventDestroy(interval.end);
+    }
+  }
+
+  bool Enabled() const { return profile.Enabled(); }
+  void Add(ProfileField field, double value) { profile.Add(field, value); }
+
+  // Runs fn, which queues work on stream, and adds the time that work takes to field
+  template <typename Fn>
+  auto Time(ProfileField field, cudaStream_t stream, Fn&& fn) -> decltype(fn())
+  {
+    Scope scope(*this, field, stream);
+    return fn();
+  }
+
+  // Waits for the timed work and folds the profile into its store, call once at the end of the task
+  void Write(cudaStream_t stream)
+  {
+    if (!profile.Enabled()) return;
+    for (const auto& interval : intervals) {
+      float ms = 0.0f;
+      CHECK_CUDA(cudaEventSynchronize(interval.end));
+      CHECK_CUDA(cudaEventElapsedTime(&ms, interval.begin, interval.end));
+      profile.Add(interval.field, ms * 1e-3);
+    }
+    struct {
+      double values[kNumProfileFields];
+    } result;
+    auto finished = profile.Finish();
+    std::copy(finished.begin(), finished.end(), result.values);
+    auto store = profile.Store();
+    auto shape = store.shape<1>();
+    EXPECT(shape.volume() == kNumProfileFields, "Unexpected profile store size.");
+    auto reduce = store.reduce_accessor<legate::SumReduction<double>, true, 1>();
+    LaunchN(kNumProfileFields, stream, [=] __device__(auto i) {
+      reduce.reduce(legate::Point<1>(shape.lo[0] + i), result.values[i]);
+    });
+    CHECK_CUDA_STREAM(stream);
+  }
+
+ private:
+  struct Interval {
+    ProfileField field;
+    cudaEvent_t begin;
+    cudaEvent_t end;
+  };
+  // Records the beginning of an interval on construction and its end on destruction
+  class Scope {
+   public:
+    Scope(StreamProfile& owner, ProfileField field, cudaStream_t stream)
+      : owner(owner), interval{field}, stream(stream)
+    {
+      if (!owner.Enabled()) return;
+      CHECK_CUDA(cudaEventCreate(&interval.begin));
+      CHECK_CUDA(cudaEventCreate(&interval.end));
+      CHECK_CUDA(cudaEventRecord(interval.begin, stream));
+    }
+    ~Scope()
+    {
+      if (!owner.Enabled()) return;
+      CHECK_CUDA(cudaEventRecord(interval.end, stream));
+      owner.intervals.push_back(interval);
+    }
+
+   private:
+    StreamProfile& owner;
+    Interval interval;
+    cudaStream_t stream;
+  };
+
+  TaskProfile& profile;
+  std::vector<Interval> intervals;
+};
+
 #if __CUDA_ARCH__ < 600
 __device__ inline double atomicAdd(double* address, double val)
 {
@@ -18,9 +18,18 @@
 #include "legate_library.h"
 #include <core/type/type_info.h>
 #include "core/comm/coll.h"
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <type_traits>
 #include <thrust/for_each.h>
 #include <thrust/iterator/counting_iterator.h>
 #include <thrust/execution_policy.h>  // for host
+#ifdef LEGATEBOOST_USE_OPENMP
+#include <thrust/system/omp/execution_policy.h>  // for omp::par
+#include <omp.h>
+#endif
 
 namespace legateboost {
 
@@ -32,6 +41,19 @@ inline void expect(bool condition, std::string message, std::string file, int li
 }
 #define EXPECT(condition, message) (expect(condition, message, __FILE__, __LINE__))
 
+// Number of threads a host execution policy spreads thrust::for_each_n over
+template <typename Policy>
+int PolicyThreads(const Policy& /*policy*/)
+{
+  return 1;
+}
+#ifdef LEGATEBOOST_USE_OPENMP
+inline int PolicyThreads(const std::decay_t<decltype(thrust::omp::par)>& /*policy*/)
+{
+  return omp_get_max_threads();
+}
+#endif
+
 template <int AXIS, typename ShapeAT, typename ShapeBT>
 void expect_axis_aligned(const ShapeAT& a, const ShapeBT& b, std::string file, int line)
 {
@@ -109,6 +131,16 @@ constexpr decltype(auto) type_dispatch_float(legate::Type::Code code, Functor&&
   type_dispatch<float, double>(code, f, std::forward<Fnargs>(args)...);
 }
 
+template <typename T>
+legate::comm::coll::CollDataType CollType()
+{
+  if (std::is_same<T, float>::value) return legate::comm::coll::CollDataType::CollFloat;
+  if (std::is_same<T, double>::value) return legate::comm::coll::CollDataType::CollDouble;
+  if (std::is_same<T, int32_t>::value) return legate::comm::coll::CollDataType::CollInt;
+  EXPECT(false, "Unsupported type.");
+  return legate::comm::coll::CollDataType::CollChar;
+}
+
 template <typename T>
 void SumAllReduce(legate::TaskContext context, T* x, int count)
 {
@@ -116,15 +148,9 @@ void SumAllReduce(legate::TaskContext context, T* x, int count)
   size_t num_ranks = domain.get_volume();
   EXPECT(num_ranks == 1 || context.num_communicators() > 0,
          "Expected a CPU communicator for multi-rank task.");
-  if (count == 0 || context.num_communicators() == 0) return;
-  auto comm = context.communicator(0);
-  legate::comm::coll::CollDataType type;
-  if (std::is_same<T, float>::value)
-    type = legate::comm::coll::CollDataType::CollFloat;
-  else if (std::is_same<T, double>::value)
-    type = legate::comm::coll::CollDataType::CollDouble;
-  else
-    EXPECT(false, "Unsupported type.");
+  if (count == 0 || num_ranks == 1 || context.num_communicators() == 0) return;
+  auto comm     = context.communicator(0);
+  auto type     = CollType<T>();
   auto comm_ptr = comm.get<legate::comm::coll::CollComm>();
   EXPECT(comm_ptr != nullptr, "CPU communicator is null.");
   size_t items_per_rank = (count + num_ranks - 1) / num_ranks;
@@ -135,10 +161,16 @@ void SumAllReduce(legate::TaskContext context, T* x, int count)
     legate::comm::coll::collAlltoall(data.data(), recvbuf.data(), items_per_rank, type, comm_ptr);
   EXPECT(result == legate::comm::coll::CollSuccess, "CPU communicator failed.");
 
-  // Sum partials
+  // Sum partials with Kahan compensation, so reducing in float loses little over many ranks
   std::vector<T> partials(items_per_rank, 0.0);
   for (size_t j = 0; j < items_per_rank; j++) {
-    for (size_t i = 0; i < num_ranks; i++) { partials[j] += recvbuf[i * items_per_rank + j]; }
+    T compensation = 0.0;
+    for (size_t i = 0; i < num_ranks; i++) {
+      T y          = recvbuf[i * items_per_rank + j] - compensation;
+      T t          = partials[j] + y;
+      compensation = (t - partials[j]) - y;
+      partials[j]  = t;
+    }
   }
 
   result = legate::comm::coll::collAllgather(
@@ -147,6 +179,194 @@ void SumAllReduce(legate::TaskContext context, T* x, int count)
   std::copy(recvbuf.begin(), recvbuf.begin() + count, x);
 }
 
+/**
+ * @brief Replicates rows held by individual ranks into `out` on every rank.
+ *
+ * Each rank passes the `count` rows it owns, packed in `rows`, and the row of `out` each one goes
+ * to. Unlike SumAllReduce over a zero-filled matrix, only owned rows are sent. The collectives have
+ * no allgatherv, so every contribution is padded to the largest count on any rank.
+ */
+template <typename T>
+void AllGatherRows(legate::TaskContext context,
+                   const T* rows,
+                   const int32_t* positions,
+                   int32_t count,
+                   int64_t n_cols,
+                   T* out)
+{
+  auto domain      = context.get_launch_domain();
+  size_t num_ranks = domain.get_volume();
+  EXPECT(num_ranks == 1 || context.num_communicators() > 0,
+         "Expected a CPU communicator for multi-rank task.");
+  if (num_ranks == 1 || context.num_communicators() == 0) {
+    for (int32_t i = 0; i < count; i++) {
+      std::copy(rows + i * n_cols, rows + (i + 1) * n_cols, out + positions[i] * n_cols);
+    }
+    return;
+  }
+  auto comm_ptr = context.communicator(0).get<legate::comm::coll::CollComm>();
+  EXPECT(comm_ptr != nullptr, "CPU communicator is null.");
+
+  std::vector<int32_t> counts(num_ranks);
+  auto result = legate::comm::coll::collAllgather(
+    &count, counts.data(), 1, legate::comm::coll::CollDataType::CollInt, comm_ptr);
+  EXPECT(result == legate::comm::coll::CollSuccess, "CPU communicator failed.");
+  int32_t max_count = *std::max_element(counts.begin(), counts.end());
+  if (max_count == 0) return;
+
+  std::vector<int32_t> send_positions(max_count);
+  std::vector<int32_t> recv_positions(max_count * num_ranks);
+  std::copy(positions, positions + count, send_positions.begin());
+  result = legate::comm::coll::collAllgather(send_positions.data(),
+                                             recv_positions.data(),
+                                             max_count,
+                                             legate::comm::coll::CollDataType::CollInt,
+                                             comm_ptr);
+  EXPECT(result == legate::comm::coll::CollSuccess, "CPU communicator failed.");
+
+  std::vector<T> send_rows(max_count * n_cols);
+  std::vector<T> recv_rows(max_count * n_cols * num_ranks);
+  std::copy(rows, rows + count * n_cols, send_rows.begin());
+  result = legate::comm::coll::collAllgather(
+    send_rows.data(), recv_rows.data(), max_count * n_cols, CollType<T>(), comm_ptr);
+  EXPECT(result == legate::comm::coll::CollSuccess, "CPU communicator failed.");
+
+  // Skip the padding at the end of each rank's contribution
+  for (size_t r = 0; r < num_ranks; r++) {
+    for (int32_t i = 0; i < counts[r]; i++) {
+      auto src = recv_rows.begin() + (r * max_count + i) * n_cols;
+      std::copy(src, src + n_cols, out + recv_positions[r * max_count + i] * n_cols);
+    }
+  }
+}
+
+/**
+ * @brief Bitwise OR of `x` over all ranks. The collectives have no bitwise reduction, so every
+ * rank's words are gathered and combined locally.
+ */
+inline void OrAllReduce(legate::TaskContext context, uint32_t* x, int count)
+{
+  auto domain      = context.get_launch_domain();
+  size_t num_ranks = domain.get_volume();
+  EXPECT(num_ranks == 1 || context.num_communicators() > 0,
+         "Expected a CPU communicator for multi-rank task.");
+  if (count == 0 || num_ranks == 1 || context.num_communicators() == 0) return;
+  auto comm_ptr = context.communicator(0).get<legate::comm::coll::CollComm>();
+  EXPECT(comm_ptr != nullptr, "CPU communicator is null.");
+  std::vector<uint32_t> recvbuf(count * num_ranks);
+  auto result = legate::comm::coll::collAllgather(
+    x, recvbuf.data(), count, legate::comm::coll::CollDataType::CollUint32, comm_ptr);
+  EXPECT(result == legate::comm::coll::CollSuccess, "CPU communicator failed.");
+  std::fill(x, x + count, 0);
+  for (size_t r = 0; r < num_ranks; r++) {
+    for (int i = 0; i < count; i++) { x[i] |= recvbuf[r * count + i]; }
+  }
+}
+
+/**
+ * @brief Fields recorded by TaskProfile. Must match PROFILE_FIELDS in legateboost/utils.py.
+ * Times are in seconds. Every field is summed over the points of a launch.
+ */
+enum class ProfileField : int {
+  kSplitProposals  = 0,  // choosing and sharing split candidates
+  kHistogram       = 1,  // accumulating gradient histograms
+  kAllReduce       = 2,  // collectives between workers
+  kScan            = 3,  // prefix sums over histogram bins
+  kSplitEvaluation = 4,  // searching histograms for the best splits
+  kUpdatePositions = 5,  // routing rows through the tree
+  kTotal           = 6,  // the whole task
+  kRows            = 7,  // rows processed
+  kBins            = 8,  // histogram bins searched for splits
+  kBytesReduced    = 9,  // bytes passed to collectives
+};
+constexpr int kNumProfileFields = 10;
+
+/**
+ * @brief Phase timers and counters of a point task.
+ *
+ * A caller requests profiling by passing a float64 store of kNumProfileFields elements with SUM
+ * reduction privileges as reduction `index`, after the task's own reductions. Without it every
+ * method returns immediately, so tasks are always instrumented and only pay for it when asked.
+ */
+class TaskProfile {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  TaskProfile(legate::TaskContext context, size_t index)
+    : enabled(context.num_reductions() > index), start(Clock::now())
+  {
+    if (enabled) store = context.reduction(index).data();
+  }
+
+  bool Enabled() const { return enabled; }
+
+  // Thread safe, pipelined phases record from several threads
+  void Add(ProfileField field, double value)
+  {
+    if (!enabled) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    values[static_cast<int>(field)] += value;
+  }
+
+  // Runs fn and adds its wall time to field
+  template <typename Fn>
+  auto Time(ProfileField field, Fn&& fn) -> decltype(fn())
+  {
+    Timer timer(*this, field);
+    return fn();
+  }
+
+  // Records the time since construction as kTotal and returns every field
+  std::array<double, kNumProfileFields> Finish()
+  {
+    Add(ProfileField::kTotal, Seconds(start));
+    std::lock_guard<std::mutex> lock(mutex);
+    return values;
+  }
+
+  legate::PhysicalStore Store() const { return store.value(); }
+
+  // Folds the fields into the profile store, call once at the end of a CPU task
+  // GPU tasks use StreamProfile::Write
+  void Write()
+  {
+    if (!enabled) return;
+    auto result = Finish();
+    auto shape  = store->shape<1>();
+    EXPECT(shape.volume() == kNumProfileFields, "Unexpected profile store size.");
+    auto reduce = store->reduce_accessor<legate::SumReduction<double>, true, 1>();
+    for (int i = 0; i < kNumProfileFields; i++) {
+      reduce.reduce(legate::Point<1>(shape.lo[0] + i), result[i]);
+    }
+  }
+
+ private:
+  static double Seconds(Clock::time_point begin)
+  {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+  }
+
+  class Timer {
+   public:
+    Timer(TaskProfile& profile, ProfileField field)
+      : profile(profile), field(field), begin(profile.enabled ? Clock::now() : Clock::time_point{})
+    {
+    }
+    ~Timer() { profile.Add(field, profile.enabled ? Seconds(begin) : 0.0); }
+
+   private:
+    TaskProfile& profile;
+    ProfileField field;
+    Clock::time_point begin;
+  };
+
+  bool enabled;
+  Clock::time_point start;
+  std::optional<legate::PhysicalStore> store;
+  std::mutex mutex;
+  std::array<double, kNumProfileFields> values{};
+};
+
 /**
  * @brief Turns linear index into multi-dimension index.  Similar to numpy unravel.
  */
@@ -240,6 +460,20 @@ class UnaryOpTask : public Task<UnaryOpTask<F, OpCode>, OpCode> {
       auto out_shape = out.shape<kDim>();
 
       auto v = out_shape.volume();
+      if (v == 0) return;
+
+      // Dense stores are walked with raw pointers over a flat index, avoiding the per-dimension
+      // unravelling and letting the compiler vectorise the loop
+      if (in_shape == out_shape && in_accessor.accessor.is_dense_row_major(in_shape) &&
+          out_accessor.accessor.is_dense_row_major(out_shape)) {
+        const T* in_ptr = in_accessor.ptr(in_shape);
+        T* out_ptr      = out_accessor.ptr(out_shape);
+        thrust::for_each_n(policy,
+                           thrust::make_counting_iterator<std::int64_t>(0),
+                           v,
+                           [=] __host__ __device__(std::int64_t i) { out_ptr[i] = f(in_ptr[i]); });
+        return;
+      }
 
       // If we use `in_accessor.ptr(in_shape)` instead of accessors, there's an
       // error from legate when repeating tests with high dimension inputs:
@@ -263,6 +497,14 @@ class UnaryOpTask : public Task<UnaryOpTask<F, OpCode>, OpCode> {
     auto const& in = context.input(0);
     legate::dim_dispatch(in.dim(), DispatchDimOp{}, context, in, thrust::host);
   }
+#ifdef LEGATEBOOST_USE_OPENMP
+  static void omp_variant(legate::TaskContext context)
+  {
+    auto const& in = context.input(0);
+    auto policy    = thrust::omp::par;
+    legate::dim_dispatch(in.dim(), DispatchDimOp{}, context, in, policy);
+  }
+#endif
   static void gpu_variant(legate::TaskContext context);
 };
 
@@ -13,9 +13,25 @@ enum LegateBoostOpCode {
   DIGAMMA = 7,
   ZETA    = 8,
   /**/
-  GATHER   = 9,
-  RBF      = 10,
-  BUILD_NN = 11,
+  GATHER           = 9,
+  RBF              = 10,
+  BUILD_NN         = 11,
+  PREDICT_NN       = 12,
+  ELEMENTWISE_EXPR = 13,
+};
+
+/* Must match the tunables queried in legateboost/models/tree.py and legateboost/utils.py */
+enum LegateBoostTunable {
+  _TUNABLE_BASE            = 0,
+  TUNABLE_SPLIT_SAMPLES    = 1,
+  TUNABLE_HISTOGRAM_CHUNKS = 2,
+  TUNABLE_SINGLE_RANK_ROWS = 3,
+};
+
+/* Positions of BUILD_TREE scalar arguments read outside the task body, by the mapper.
+   Must match the order of add_scalar_arg in legateboost/models/tree.py */
+enum LegateBoostBuildTreeScalar {
+  BUILD_TREE_FEATURE_PARALLEL = 8,
 };
 
 #endif  // __LEGATEBOOST_C_H__
@@ -16,12 +16,94 @@
 
 #include "mapper.h"
 #include "legateboost.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
 
 namespace legateboost {
 
 LegateboostMapper::LegateboostMapper() {}
 
-void LegateboostMapper::set_machine(const legate::mapping::MachineQueryInterface* /*machine*/) {}
+namespace {
+// Rows per second accumulated into gradient pair histograms with bins_per_feature bins for each of
+// a fixed number of features, as the CPU ComputeHistogram loop does
+double HistogramThroughput(int bins_per_feature)
+{
+  const int num_features = 32;
+  const int num_rows     = 1 << 14;
+  const int repeats      = 4;
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int32_t> uniform(0, bins_per_feature - 1);
+  std::vector<int32_t> bins(num_rows * num_features);
+  for (auto& bin : bins) { bin = uniform(rng); }
+  std::vector<double> histogram(num_features * bins_per_feature * 2, 0.0);
+  auto begin = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; r++) {
+    for (int i = 0; i < num_rows; i++) {
+      for (int j = 0; j < num_features; j++) {
+        auto idx = (j * bins_per_feature + bins[i * num_features + j]) * 2;
+        histogram[idx] += 1.0;
+        histogram[idx + 1] += 0.5;
+      }
+    }
+  }
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - begin;
+  // Keep the loop from being optimised away
+  volatile double sink = histogram[0];
+  (void)sink;
+  return repeats * num_rows / seconds.count();
+}
+
+// The most split candidates whose histograms still accumulate at close to the best rate measured,
+// typically the largest histograms that stay in cache
+int32_t CalibrateSplitSamples()
+{
+  const std::vector<int32_t> candidates = {64, 128, 256, 512, 1024, 2048};
+  std::vector<double> throughput;
+  for (auto bins : candidates) { throughput.push_back(HistogramThroughput(bins)); }
+  double best    = *std::max_element(throughput.begin(), throughput.end());
+  int32_t result = candidates.front();
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (throughput[i] >= 0.8 * best) result = candidates[i];
+  }
+  return result;
+}
+}  // namespace
+
+// The tunables keep their defaults unless LEGATEBOOST_CALIBRATE is set
+// Each node's mapper calibrates on its own. Tunable queries under control replication are answered
+// by the first shard's mapper and broadcast, and the Python models pass the value to their tasks as
+// a scalar, so every worker uses the first rank's measurement.
+// LEGATEBOOST_SINGLE_RANK_ROWS overrides TUNABLE_SINGLE_RANK_ROWS, 0 launches every task over all
+// workers
+void LegateboostMapper::set_machine(const legate::mapping::MachineQueryInterface* machine)
+{
+  const char* rows = std::getenv("LEGATEBOOST_SINGLE_RANK_ROWS");
+  if (rows != nullptr) single_rank_rows = std::max(0, std::stoi(rows));
+  const char* calibrate = std::getenv("LEGATEBOOST_CALIBRATE");
+  if (calibrate == nullptr || std::string(calibrate) == "0") return;
+  bool use_gpus = !machine->gpus().empty();
+  auto ranks    = machine->total_nodes() *
+               (use_gpus ? machine->gpus().size() : machine->cpus().size());
+  // Chunks only overlap summing a level's histogram over workers with searching it
+  histogram_chunks = ranks > 1 ? histogram_chunks : 1;
+  // The benchmark measures host histograms, GPU kernels are limited by shared memory instead
+  if (!use_gpus) split_samples = CalibrateSplitSamples();
+}
+
+namespace {
+// Memory for the stores of a point task, options are the memories of its processor
+// An OpenMP processor runs on one socket, its socket memory keeps data on that NUMA node
+// The tree tasks have OpenMP variants, so they run on OpenMP processors when the machine has any
+legate::mapping::StoreTarget LocalTarget(const std::vector<legate::mapping::StoreTarget>& options)
+{
+  auto socket = std::find(options.begin(), options.end(), legate::mapping::StoreTarget::SOCKETMEM);
+  return socket != options.end() ? *socket : options.front();
+}
+}  // namespace
 
 legate::mapping::TaskTarget LegateboostMapper::task_target(
   const legate::mapping::Task& /*task*/, const std::vector<legate::mapping::TaskTarget>& options)
@@ -29,27 +111,50 @@ legate::mapping::TaskTarget LegateboostMapper::task_target(
   return *options.begin();
 }
 
-legate::Scalar LegateboostMapper::tunable_value(legate::TunableID /*tunable_id*/)
+legate::Scalar LegateboostMapper::tunable_value(legate::TunableID tunable_id)
 {
-  return legate::Scalar{};
+  switch (tunable_id) {
+    case TUNABLE_SPLIT_SAMPLES: return legate::Scalar(split_samples);
+    case TUNABLE_HISTOGRAM_CHUNKS: return legate::Scalar(histogram_chunks);
+    case TUNABLE_SINGLE_RANK_ROWS: return legate::Scalar(single_rank_rows);
+    default: return legate::Scalar{};
+  }
 }
 
 std::vector<legate::mapping::StoreMapping> LegateboostMapper::store_mappings(
   const legate::mapping::Task& task, const std::vector<legate::mapping::StoreTarget>& options)
 {
-  auto task_id = task.task_id();
-  // Enforce c-ordering for these tasks
-  std::set<LegateBoostOpCode> row_major_only = {BUILD_TREE};
+  auto task_id = static_cast<LegateBoostOpCode>(task.task_id());
   std::vector<legate::mapping::StoreMapping> mappings;
-  if (row_major_only.count(static_cast<LegateBoostOpCode>(task_id))) {
-    for (auto input : task.inputs()) {
-      mappings.push_back(
-        legate::mapping::StoreMapping::default_mapping(input.data(), options.front()));
-      mappings.back().policy().ordering.set_c_order();
-      mappings.back().policy().exact = true;
+  std::set<LegateBoostOpCode> tree_tasks = {BUILD_TREE, PREDICT, UPDATE_TREE};
+  if (!tree_tasks.count(task_id)) return mappings;
+  auto target = LocalTarget(options);
+
+  // The tree tasks read X, their first input, through dense row major pointers
+  // Each round launches them on a freshly promoted view of the same X. Unless BUILD_TREE partitions
+  // features, X is broadcast over features, so every point task reads whole rows and any
+  // C ordered instance holding them is dense over its piece. Not asking for an exact instance lets
+  // the runtime reuse the instance laid out in an earlier round or by another task, instead of
+  // copying X again.
+  bool feature_parallel =
+    task_id == BUILD_TREE && task.scalar(BUILD_TREE_FEATURE_PARALLEL).value<bool>();
+  mappings.push_back(
+    legate::mapping::StoreMapping::default_mapping(task.inputs().front().data(), target));
+  mappings.back().policy().ordering.set_c_order();
+  mappings.back().policy().exact = feature_parallel;
+
+  // The other stores keep the default layout in the memory local to the processor. Launches over
+  // the same partition place each piece on the same processor every round, so data reused across
+  // rounds stays on its socket.
+  auto map_local = [&](const std::vector<legate::mapping::Array>& arrays, size_t begin) {
+    for (size_t i = begin; i < arrays.size(); i++) {
+      if (arrays[i].data().is_future()) continue;
+      mappings.push_back(legate::mapping::StoreMapping::default_mapping(arrays[i].data(), target));
     }
-    return mappings;
-  }
+  };
+  map_local(task.inputs(), 1);
+  map_local(task.outputs(), 0);
+  map_local(task.reductions(), 0);
   return mappings;
 }
 
@@ -38,6 +38,13 @@ class LegateboostMapper : public legate::mapping::Mapper {
     const legate::mapping::Task& task,
     const std::vector<legate::mapping::StoreTarget>& options) override;
   virtual legate::Scalar tunable_value(legate::TunableID tunable_id) override;
+
+ private:
+  // Defaults for the Tree parameters left as None, see set_machine
+  int32_t split_samples    = 256;
+  int32_t histogram_chunks = 4;
+  // Tasks over fewer rows run as a single point task without a communicator
+  int32_t single_rank_rows = 8192;
 };
 
 }  // namespace legateboost
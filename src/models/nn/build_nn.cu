@@ -1,7 +1,8 @@
 #include "build_nn.h"
 #include <thrust/device_vector.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
 #include "cublas_v2.h"
-#include <deque>
 
 namespace legateboost {
 
@@ -18,7 +19,8 @@ void SyncCPU(legate::TaskContext context)
 {
   auto domain      = context.get_launch_domain();
   size_t num_ranks = domain.get_volume();
-  if (num_ranks == 1) return;
+  // Nothing to synchronise with if the task has no NCCL and CPU communicators
+  if (num_ranks == 1 || context.num_communicators() < 2) return;
   auto comm = context.communicator(1);
   std::vector<float> gather_result(num_ranks);
   auto comm_ptr = comm.get<legate::comm::coll::CollComm>();
@@ -38,14 +40,23 @@ class NNContext {
   std::vector<std::array<int64_t, 2>> coefficient_extents;
   std::vector<std::array<int64_t, 2>> bias_extents;
   int64_t num_parameters;
+  Activation activation;
   legate::TaskContext legate_context;
+  TaskProfile task_profile;  // Enabled if the task has a profile reduction store
+  StreamProfile profile;
   template <typename T>
   NNContext(legate::TaskContext context,
             const std::vector<Matrix<T>>& coefficients,
             const std::vector<Matrix<T>>& bias,
+            Activation activation,
             cudaStream_t stream)
-    : stream(stream), legate_context(context)
+    : stream(stream),
+      activation(activation),
+      legate_context(context),
+      task_profile(context, 0),
+      profile(task_profile)
   {
+    reduce_result = legate::create_buffer<double, 1>(kMaxReduceResults);
     CUBLAS_ERROR(cublasCreate(&handle));
     // Without syncronising, cublas creation can hang
     SyncCPU(context);
@@ -64,7 +75,44 @@ class NNContext {
       num_parameters += b.size();
     }
   }
-  ~NNContext() { CUBLAS_ERROR(cublasDestroy(handle)); }
+  ~NNContext()
+  {
+    CUBLAS_ERROR(cublasDestroy(handle));
+    reduce_result.destroy();
+    if (reduce_storage_bytes > 0) reduce_storage.destroy();
+  }
+
+  // Device memory for reduction results and temp storage, reused across calls
+  // The last result slot is scratch for accumulating reductions
+  static constexpr int kMaxReduceResults = 8;
+  static_assert(kLineSearchCandidates < kMaxReduceResults);
+  legate::Buffer<double, 1> reduce_result;
+  legate::Buffer<int8_t, 1> reduce_storage;
+  std::size_t reduce_storage_bytes = 0;
+  template <typename T>
+  T* ReduceResult()
+  {
+    return reinterpret_cast<T*>(reduce_result.ptr({0}));
+  }
+  int8_t* ReduceStorage(std::size_t bytes)
+  {
+    bytes = std::max(bytes, std::size_t(1));
+    if (bytes > reduce_storage_bytes) {
+      if (reduce_storage_bytes > 0) reduce_storage.destroy();
+      reduce_storage       = legate::create_buffer<int8_t, 1>(bytes);
+      reduce_storage_bytes = bytes;
+    }
+    return reduce_storage.ptr({0});
+  }
+
+  // Sums x over workers on the stream, recorded in the profile
+  template <typename T>
+  void AllReduce(T* x, int count)
+  {
+    profile.Add(ProfileField::kBytesReduced, count * sizeof(T));
+    profile.Time(
+      ProfileField::kAllReduce, stream, [&] { SumAllReduce(legate_context, x, count, stream); });
+  }
   template <typename T>
   std::tuple<std::vector<Matrix<T>>, std::vector<Matrix<T>>> Unpack(Matrix<T>& x)
   {
@@ -84,7 +132,7 @@ class NNContext {
 };
 
 template <bool transpose_A = false, bool transpose_B = false, typename T1, typename T2, typename T3>
-void dot(NNContext* context, Matrix<T1>& A, Matrix<T2>& B, Matrix<T3>& C)
+void dot(NNContext* context, Matrix<T1>& A, Matrix<T2>& B, Matrix<T3>& C, bool accumulate = false)
 {
   if (A.size() == 0 || B.size() == 0) return;
   using T = typename std::remove_const<T1>::type;
@@ -101,7 +149,7 @@ void dot(NNContext* context, Matrix<T1>& A, Matrix<T2>& B, Matrix<T3>& C)
   int k = transpose_A ? A.extent[0] : A.extent[1];
 
   T alpha = 1.0;
-  T beta  = 0.0;
+  T beta  = accumulate ? 1.0 : 0.0;
 
   auto op_A = transpose_A ? CUBLAS_OP_T : CUBLAS_OP_N;
   auto op_B = transpose_B ? CUBLAS_OP_T : CUBLAS_OP_N;
@@ -154,27 +202,25 @@ void print(Matrix<T>& A, int64_t n)
 }
 
 template <typename T>
-Matrix<T> multiply(Matrix<T>& A, T scalar)
+void multiply(Matrix<T>& A, T scalar, Matrix<T>& result)
 {
-  auto result = Matrix<T>::Create(A.extent);
+  EXPECT(A.size() == result.size(), "Matrix dimensions must match");
   auto stream = legate::cuda::StreamPool::get_stream_pool().get_stream();
   auto out    = result.data;
   auto in     = A.data;
   LaunchN(A.size(), stream, [=] __device__(int64_t idx) { out[idx] = in[idx] * scalar; });
-  return result;
 }
 
 template <typename T>
-Matrix<T> subtract(const Matrix<T>& A, const Matrix<T>& B)
+void subtract(const Matrix<T>& A, const Matrix<T>& B, Matrix<T>& result)
 {
   EXPECT(A.extent == B.extent, "Matrix dimensions must match");
-  auto result     = Matrix<T>::Create(A.extent);
+  EXPECT(A.size() == result.size(), "Matrix dimensions must match");
   auto stream     = legate::cuda::StreamPool::get_stream_pool().get_stream();
   auto in         = A.data;
   auto out        = result.data;
   auto other_data = B.data;
   LaunchN(A.size(), stream, [=] __device__(int64_t idx) { out[idx] = in[idx] - other_data[idx]; });
-  return result;
 }
 
 template <typename T, typename T2>
@@ -221,20 +267,32 @@ void add_bias(NNContext* context, Matrix<T>& A, Matrix<T>& bias)
   });
 }
 
-template <typename T>
-void tanh(NNContext* context, Matrix<T>& A)
+// Fused bias add and activation in a single pass over A
+// pre_activation receives A + bias if the activation derivative needs it
+// It is null when no backward pass follows, as in prediction
+template <typename T, typename Op>
+void bias_activation(
+  NNContext* context, Matrix<T>& A, Matrix<T>& bias, Matrix<T>* pre_activation, Op)
 {
+  T* pre = Op::kNeedsPreActivation && pre_activation != nullptr ? pre_activation->data : nullptr;
   LaunchN(A.size(), context->stream, [=] __device__(int64_t idx) {
-    A.data[idx] = std::tanh(A.data[idx]);
+    int64_t j = idx % A.extent[1];
+    T z       = A.data[idx] + bias.data[j];
+    if constexpr (Op::kNeedsPreActivation) {
+      if (pre != nullptr) pre[idx] = z;
+    }
+    A.data[idx] = Op::Apply(z);
   });
 }
 
-template <typename T>
-void tanh_prime(NNContext* context, Matrix<T>& H, Matrix<T>& delta)
+// delta is multiplied by the activation derivative
+template <typename T, typename Op>
+void activation_prime(
+  NNContext* context, Matrix<T>* pre_activation, Matrix<T>& H, Matrix<T>& delta, Op)
 {
+  T* pre = Op::kNeedsPreActivation ? pre_activation->data : H.data;
   LaunchN(H.size(), context->stream, [=] __device__(int64_t idx) {
-    T val = H.data[idx];
-    delta.data[idx] *= 1 - val * val;
+    delta.data[idx] *= Op::Derivative(pre[idx], H.data[idx]);
   });
 }
 
@@ -246,59 +304,88 @@ void apply_alpha(NNContext* context, Matrix<T>& grad, Matrix<T>& coeff, double a
   });
 }
 
+// Cost of the local rows written to device memory at result, before the allreduce
+// With accumulate the cost is added to result instead
 template <typename T>
-T eval_cost(NNContext* context,
-            Matrix<T>& pred,
-            Matrix<double>& g,
-            Matrix<double>& h,
-            std::vector<Matrix<T>>& coefficients,
-            int64_t total_rows,
-            double alpha)
+void eval_cost_local(NNContext* context,
+                     Matrix<T>& pred,
+                     Matrix<double>& g,
+                     Matrix<double>& h,
+                     int64_t total_rows,
+                     T* result,
+                     bool accumulate = false)
 {
-  Matrix<T> cost_array = Matrix<T>::Create({pred.extent[0], pred.extent[1]});
   EXPECT(pred.extent == g.extent, "Preds not equal to gradient size");
   EXPECT(pred.extent == h.extent, "Preds not equal to gradient size");
 
-  LaunchN(pred.size(), context->stream, [=] __device__(int64_t idx) {
-    T p                  = pred.data[idx];
-    T g_val              = g.data[idx];
-    T h_val              = h.data[idx];
-    cost_array.data[idx] = (p * (g_val + 0.5 * h_val * p) / (total_rows * pred.extent[1]));
-  });
+  // Evaluate the cost elementwise inside the reduction instead of materialising it
+  auto counting   = thrust::make_counting_iterator<int64_t>(0);
+  auto cost_array = thrust::make_transform_iterator(
+    counting, [=] __host__ __device__(int64_t idx) -> T {
+      T p     = pred.data[idx];
+      T g_val = g.data[idx];
+      T h_val = h.data[idx];
+      return (p * (g_val + 0.5 * h_val * p) / (total_rows * pred.extent[1]));
+    });
 
-  auto result               = legate::create_buffer<T>({1});
   size_t temp_storage_bytes = 0;
   cub::DeviceReduce::Sum(nullptr,
                          temp_storage_bytes,
-                         cost_array.data,
-                         result.ptr({0}),
-                         cost_array.size(),
+                         cost_array,
+                         static_cast<T*>(nullptr),
+                         pred.size(),
                          context->stream);
-  auto temp_storage = legate::create_buffer<int8_t>({temp_storage_bytes});
-  cub::DeviceReduce::Sum(temp_storage.ptr({0}),
+  T* sum = accumulate ? context->ReduceResult<T>() + NNContext::kMaxReduceResults - 1 : result;
+  cub::DeviceReduce::Sum(context->ReduceStorage(temp_storage_bytes),
                          temp_storage_bytes,
-                         cost_array.data,
-                         result.ptr({0}),
-                         cost_array.size(),
+                         cost_array,
+                         sum,
+                         pred.size(),
                          context->stream);
-  SumAllReduce(context->legate_context, result.ptr({0}), 1, context->stream);
+  if (accumulate) {
+    LaunchN(1, context->stream, [=] __device__(int64_t idx) { *result += *sum; });
+  }
+}
+
+template <typename T>
+T l2_cost(NNContext* context,
+          std::vector<Matrix<T>>& coefficients,
+          int64_t total_rows,
+          double alpha)
+{
+  if (alpha <= 0.0) return 0.0;
+  T L2 = 0.0;
+  for (auto& c : coefficients) { L2 += vector_dot(context, c, c); }
+  return (0.5 * alpha) * L2 / total_rows;
+}
+
+template <typename T>
+T eval_cost(NNContext* context,
+            Matrix<T>& pred,
+            Matrix<double>& g,
+            Matrix<double>& h,
+            std::vector<Matrix<T>>& coefficients,
+            int64_t total_rows,
+            double alpha)
+{
+  auto result = context->ReduceResult<T>();
+  eval_cost_local(context, pred, g, h, total_rows, result);
+  context->AllReduce(result, 1);
 
   T cost;
-  cudaMemcpyAsync(&cost, result.ptr({0}), sizeof(T), cudaMemcpyDeviceToHost, context->stream);
+  cudaMemcpyAsync(&cost, result, sizeof(T), cudaMemcpyDeviceToHost, context->stream);
   CHECK_CUDA(cudaStreamSynchronize(context->stream));
-  if (alpha > 0.0) {
-    T L2 = 0.0;
-    for (auto& c : coefficients) { L2 += vector_dot(context, c, c); }
-    L2 = (0.5 * alpha) * L2 / total_rows;
-    cost += L2;
-  }
-  return cost;
+  return cost + l2_cost(context, coefficients, total_rows, alpha);
 }
 
 template <typename T>
-Matrix<T> eval_cost_prime(NNContext* context, Matrix<T>& pred, Matrix<double>& g, Matrix<double>& h)
+void eval_cost_prime(NNContext* context,
+                     Matrix<T>& pred,
+                     Matrix<double>& g,
+                     Matrix<double>& h,
+                     Matrix<T>& cost_prime)
 {
-  Matrix<T> cost_prime = Matrix<T>::Create({pred.extent[0], pred.extent[1]});
+  EXPECT(pred.extent == cost_prime.extent, "Preds not equal to cost prime size");
   EXPECT(pred.extent == g.extent, "Preds not equal to gradient size");
   EXPECT(pred.extent == h.extent, "Preds not equal to gradient size");
 
@@ -308,60 +395,95 @@ Matrix<T> eval_cost_prime(NNContext* context, Matrix<T>& pred, Matrix<double>& g
     T h_val              = h.data[idx];
     cost_prime.data[idx] = g_val + h_val * p;
   });
-  return cost_prime;
 }
 
+// ones is a preallocated row vector of 1s with one entry per row of delta
+template <typename T>
+void bias_grad(NNContext* context,
+               Matrix<T>& delta,
+               Matrix<T>& ones,
+               Matrix<T>& bias_grad,
+               bool accumulate = false)
+{
+  dot<false, false>(context, ones, delta, bias_grad, accumulate);
+}
+
+// Bias and activation of layer i, applied in place to the product held in activations.at(i + 1)
 template <typename T>
-void bias_grad(NNContext* context, Matrix<T>& delta, Matrix<T>& bias_grad)
+void layer_epilogue(NNContext* nn_context,
+                    int i,
+                    std::vector<Matrix<T>>& biases,
+                    std::vector<Matrix<T>>& activations,
+                    std::vector<Matrix<T>>& pre_activations)
 {
-  auto ones = Matrix<T>::Create({1, delta.extent[0]});
-  fill(ones, 1.0);
-  dot<false, false>(context, ones, delta, bias_grad);
+  if (i < biases.size() - 1) {
+    auto pre = pre_activations.empty() ? nullptr : &pre_activations.at(i);
+    activation_dispatch<T>(nn_context->activation, [&](auto op) {
+      bias_activation(nn_context, activations.at(i + 1), biases.at(i), pre, op);
+    });
+  } else {
+    add_bias(nn_context, activations.at(i + 1), biases.at(i));
+  }
 }
 
+// pre_activations is empty unless the activation needs them for backward
 template <typename T>
 void forward(NNContext* nn_context,
              std::vector<Matrix<T>>& coefficients,
              std::vector<Matrix<T>>& biases,
-             std::vector<Matrix<T>>& activations)
+             std::vector<Matrix<T>>& activations,
+             std::vector<Matrix<T>>& pre_activations,
+             int begin_layer = 0)
 {
-  for (int i = 0; i < coefficients.size(); i++) {
+  for (int i = begin_layer; i < coefficients.size(); i++) {
     dot(nn_context, activations.at(i), coefficients.at(i), activations.at(i + 1));
-    add_bias(nn_context, activations.at(i + 1), biases.at(i));
-    if (i < coefficients.size() - 1) tanh(nn_context, activations.at(i + 1));
+    layer_epilogue(nn_context, i, biases, activations, pre_activations);
   }
 }
 
+// Adds the gradient of one block of rows to grads
+// Expects the block's activations to hold the forward pass for the current coefficients
 template <typename T>
-Matrix<T> backward(NNContext* nn_context,
-                   std::vector<Matrix<T>>& coefficients,
-                   std::vector<Matrix<T>>& bias,
-                   std::vector<Matrix<T>>& activations,
-                   std::vector<Matrix<T>>& deltas,
-                   Matrix<double>& g,
-                   Matrix<double>& h,
-                   std::size_t total_rows,
-                   double alpha)
+void backward_block(NNContext* nn_context,
+                    std::vector<Matrix<T>>& coefficients,
+                    typename NNWorkspace<T>::Block& block,
+                    Matrix<T>& grads)
 {
-  auto grads = Matrix<T>::Create({nn_context->num_parameters, 1});
-  fill(grads, 0.0);
   auto [coefficient_grads, bias_grads] = nn_context->Unpack(grads);
-  forward(nn_context, coefficients, bias, activations);
+  auto& activations                    = block.activations;
+  auto& deltas                         = block.deltas;
 
-  deltas.back() = eval_cost_prime(nn_context, activations.back(), g, h);
-  dot<true, false>(
-    nn_context, activations.at(activations.size() - 2), deltas.back(), coefficient_grads.back());
-  bias_grad(nn_context, deltas.back(), bias_grads.back());
+  eval_cost_prime(nn_context, activations.back(), block.g, block.h, deltas.back());
+  dot<true, false>(nn_context,
+                   activations.at(activations.size() - 2),
+                   deltas.back(),
+                   coefficient_grads.back(),
+                   true);
+  bias_grad(nn_context, deltas.back(), block.ones, bias_grads.back(), true);
 
   for (int i = coefficients.size() - 1; i > 0; i--) {
     dot<false, true>(nn_context, deltas.at(i), coefficients.at(i), deltas.at(i - 1));
-    tanh_prime(nn_context, activations.at(i), deltas.at(i - 1));
+    auto pre = block.pre_activations.empty() ? nullptr : &block.pre_activations.at(i - 1);
+    activation_dispatch<T>(nn_context->activation, [&](auto op) {
+      activation_prime(nn_context, pre, activations.at(i), deltas.at(i - 1), op);
+    });
     dot<true, false>(
-      nn_context, activations.at(i - 1), deltas.at(i - 1), coefficient_grads.at(i - 1));
+      nn_context, activations.at(i - 1), deltas.at(i - 1), coefficient_grads.at(i - 1), true);
 
-    bias_grad(nn_context, deltas.at(i - 1), bias_grads.at(i - 1));
+    bias_grad(nn_context, deltas.at(i - 1), block.ones, bias_grads.at(i - 1), true);
   }
+}
 
+// Regularisation, allreduce and scaling once every block has been added to grads
+template <typename T>
+void finish_grad(NNContext* nn_context,
+                 std::vector<Matrix<T>>& coefficients,
+                 std::size_t total_rows,
+                 double alpha,
+                 Matrix<T>& grads,
+                 bool allreduce)
+{
+  auto [coefficient_grads, bias_grads] = nn_context->Unpack(grads);
   if (alpha > 0.0) {
     for (int i = 0; i < coefficients.size(); i++) {
       apply_alpha(nn_context, coefficient_grads.at(i), coefficients.at(i), alpha);
@@ -369,11 +491,85 @@ Matrix<T> backward(NNContext* nn_context,
   }
 
   // Scale and allreduce gradients
-  SumAllReduce(nn_context->legate_context, grads.data, grads.size(), nn_context->stream);
+  if (allreduce) {
+    nn_context->AllReduce(grads.data, grads.size());
+  }
   LaunchN(grads.size(), nn_context->stream, [=] __device__(int64_t idx) {
     grads.data[idx] /= total_rows;
   });
-  return grads;
+}
+
+// Gradient of a single block
+template <typename T>
+void backward(NNContext* nn_context,
+              std::vector<Matrix<T>>& coefficients,
+              typename NNWorkspace<T>::Block& block,
+              std::size_t total_rows,
+              double alpha,
+              Matrix<T>& grads,
+              bool allreduce = true)
+{
+  fill(grads, 0.0);
+  backward_block(nn_context, coefficients, block, grads);
+  finish_grad(nn_context, coefficients, total_rows, alpha, grads, allreduce);
+}
+
+// Cost over every block of rows with a single allreduce
+// With one block its forward pass stays in the workspace for eval_grad
+template <typename T>
+T eval_cost_blocks(NNContext* nn_context,
+                   std::vector<Matrix<T>>& coefficients,
+                   std::vector<Matrix<T>>& bias,
+                   NNWorkspace<T>& workspace,
+                   const RowBlocks& blocks,
+                   Matrix<T>& X,
+                   Matrix<double>& g,
+                   Matrix<double>& h,
+                   std::size_t total_rows,
+                   double alpha)
+{
+  auto result = nn_context->ReduceResult<T>();
+  for (int64_t b = 0; b < blocks.Count(); b++) {
+    auto [begin, end] = blocks.Bounds(b);
+    auto block        = workspace.View(X, g, h, begin, end);
+    forward(nn_context, coefficients, bias, block.activations, block.pre_activations);
+    eval_cost_local(
+      nn_context, block.activations.back(), block.g, block.h, total_rows, result, b > 0);
+  }
+  nn_context->AllReduce(result, 1);
+
+  T cost;
+  cudaMemcpyAsync(&cost, result, sizeof(T), cudaMemcpyDeviceToHost, nn_context->stream);
+  CHECK_CUDA(cudaStreamSynchronize(nn_context->stream));
+  return cost + l2_cost(nn_context, coefficients, total_rows, alpha);
+}
+
+// Gradient over every block of rows
+// A single block reuses the forward pass of the last cost evaluation, otherwise each block is
+// recomputed before its backward pass
+template <typename T>
+void eval_grad(NNContext* nn_context,
+               std::vector<Matrix<T>>& coefficients,
+               std::vector<Matrix<T>>& bias,
+               NNWorkspace<T>& workspace,
+               const RowBlocks& blocks,
+               Matrix<T>& X,
+               Matrix<double>& g,
+               Matrix<double>& h,
+               std::size_t total_rows,
+               double alpha,
+               Matrix<T>& grads)
+{
+  fill(grads, 0.0);
+  for (int64_t b = 0; b < blocks.Count(); b++) {
+    auto [begin, end] = blocks.Bounds(b);
+    auto block        = workspace.View(X, g, h, begin, end);
+    if (blocks.Count() > 1) {
+      forward(nn_context, coefficients, bias, block.activations, block.pre_activations);
+    }
+    backward_block(nn_context, coefficients, block, grads);
+  }
+  finish_grad(nn_context, coefficients, total_rows, alpha, grads, true);
 }
 
 template <typename T>
@@ -404,14 +600,98 @@ void update_coefficients(NNContext* nn_context,
   }
 }
 
+template <typename T>
+void copy(NNContext* context, const Matrix<T>& src, Matrix<T>& dst)
+{
+  EXPECT(src.size() == dst.size(), "Matrix dimensions must match");
+  CHECK_CUDA(cudaMemcpyAsync(
+    dst.data, src.data, src.size() * sizeof(T), cudaMemcpyDeviceToDevice, context->stream));
+}
+
+// Costs of several step sizes from one pass over the data and a single allreduce
+// The input is shared by all candidates, so the first layer is one GEMM against [W | direction]
+// and each candidate combines the two halves. Later layers run per candidate in the candidate
+// workspace, which streams the rows in passes of at most kLineSearchBlockRows.
+template <typename T>
+std::vector<T> eval_candidates(NNContext* nn_context,
+                               std::vector<Matrix<T>>& coefficients,
+                               std::vector<Matrix<T>>& bias,
+                               Matrix<T>& direction,
+                               NNWorkspace<T>& workspace,
+                               Matrix<T>& X,
+                               Matrix<double>& g,
+                               Matrix<double>& h,
+                               std::size_t total_rows,
+                               double alpha,
+                               const std::vector<T>& lrs)
+{
+  auto [coefficient_direction, bias_direction] = nn_context->Unpack(direction);
+  auto [coefficient_proposals, bias_proposals] = nn_context->Unpack(workspace.proposal);
+
+  auto& candidates = workspace.Candidates();
+  auto W           = coefficients.front().data;
+  auto D           = coefficient_direction.front().data;
+  int64_t width    = coefficients.front().extent[1];
+  auto stacked     = candidates.stacked_weights.data;
+  LaunchN(candidates.stacked_weights.size(), nn_context->stream, [=] __device__(int64_t idx) {
+    int64_t r    = idx / (2 * width);
+    int64_t k    = idx % (2 * width);
+    stacked[idx] = k < width ? W[r * width + k] : D[r * width + k - width];
+  });
+
+  auto results = nn_context->ReduceResult<T>();
+  std::vector<T> l2(lrs.size());
+  RowBlocks passes(X.extent[0], candidates.rows);
+  for (int64_t b = 0; b < passes.Count(); b++) {
+    auto [begin, end]   = passes.Bounds(b);
+    int64_t rows        = end - begin;
+    auto X_block        = X.Rows(begin, end);
+    auto g_block        = g.Rows(begin, end);
+    auto h_block        = h.Rows(begin, end);
+    auto stacked_output = candidates.stacked_output.Rows(0, rows);
+    dot(nn_context, X_block, candidates.stacked_weights, stacked_output);
+
+    for (int j = 0; j < lrs.size(); j++) {
+      T lr = lrs.at(j);
+      update_coefficients(
+        nn_context, coefficients, coefficient_proposals, bias, bias_proposals, direction, lr);
+      std::vector<Matrix<T>> activations({X_block});
+      for (auto& a : TopRows(candidates.activations.at(j), rows)) activations.push_back(a);
+      auto pre_activations = TopRows(candidates.pre_activations.at(j), rows);
+      auto first           = activations.at(1);
+      auto out             = stacked_output.data;
+      LaunchN(first.size(), nn_context->stream, [=] __device__(int64_t idx) {
+        int64_t r       = idx / width;
+        int64_t k       = idx % width;
+        first.data[idx] = out[r * 2 * width + k] + lr * out[r * 2 * width + width + k];
+      });
+      layer_epilogue(nn_context, 0, bias_proposals, activations, pre_activations);
+      forward(nn_context, coefficient_proposals, bias_proposals, activations, pre_activations, 1);
+      eval_cost_local(
+        nn_context, activations.back(), g_block, h_block, total_rows, results + j, b > 0);
+      if (b == 0) l2.at(j) = l2_cost(nn_context, coefficient_proposals, total_rows, alpha);
+    }
+  }
+
+  nn_context->AllReduce(results, lrs.size());
+  std::vector<T> costs(lrs.size());
+  CHECK_CUDA(cudaMemcpyAsync(
+    costs.data(), results, lrs.size() * sizeof(T), cudaMemcpyDeviceToHost, nn_context->stream));
+  CHECK_CUDA(cudaStreamSynchronize(nn_context->stream));
+  for (int j = 0; j < lrs.size(); j++) { costs.at(j) += l2.at(j); }
+  return costs;
+}
+
+// With a single block of rows the workspace holds the forward pass for the accepted step on return
 template <typename T>
 std::tuple<T, T> line_search(NNContext* nn_context,
                              std::vector<Matrix<T>>& coefficients,
                              std::vector<Matrix<T>>& bias,
                              Matrix<T>& direction,
                              Matrix<T>& grad,
-                             std::vector<Matrix<T>>& activations,
-                             std::vector<Matrix<T>>& deltas,
+                             NNWorkspace<T>& workspace,
+                             const RowBlocks& blocks,
+                             Matrix<T>& X,
                              Matrix<double>& g,
                              Matrix<double>& h,
                              std::size_t total_rows,
@@ -423,22 +703,70 @@ std::tuple<T, T> line_search(NNContext* nn_context,
   T c   = 1e-4;
   T t   = -c * vector_dot(nn_context, grad, direction);
   EXPECT(t >= 0, "Search direction is not a descent direction");
-  auto coeff_proposal_storage = Matrix<T>::Create({nn_context->num_parameters, 1});
-  fill(coeff_proposal_storage, 0.0);
-  auto [coefficient_proposals, bias_proposals] = nn_context->Unpack(coeff_proposal_storage);
+  auto [coefficient_proposals, bias_proposals] = nn_context->Unpack(workspace.proposal);
   update_coefficients(
     nn_context, coefficients, coefficient_proposals, bias, bias_proposals, direction, lr);
-  forward(nn_context, coefficient_proposals, bias_proposals, activations);
-  T new_cost =
-    eval_cost(nn_context, activations.back(), g, h, coefficient_proposals, total_rows, alpha);
-
+  T new_cost = eval_cost_blocks(nn_context,
+                                coefficient_proposals,
+                                bias_proposals,
+                                workspace,
+                                blocks,
+                                X,
+                                g,
+                                h,
+                                total_rows,
+                                alpha);
+
+  // The first step is usually accepted, otherwise backtrack through several step sizes per pass
+  bool streamed = false;
   while (cost - new_cost < lr * t && lr * rho > 1e-15) {
-    lr *= rho;
+    std::vector<T> lrs;
+    for (T next = lr * rho; lrs.size() < kLineSearchCandidates && next > 1e-15; next *= rho) {
+      lrs.push_back(next);
+    }
+    auto costs = eval_candidates(nn_context,
+                                 coefficients,
+                                 bias,
+                                 direction,
+                                 workspace,
+                                 X,
+                                 g,
+                                 h,
+                                 total_rows,
+                                 alpha,
+                                 lrs);
+    int accepted = lrs.size() - 1;
+    for (int j = 0; j < lrs.size(); j++) {
+      if (!(cost - costs.at(j) < lrs.at(j) * t)) {
+        accepted = j;
+        break;
+      }
+    }
+    lr       = lrs.at(accepted);
+    new_cost = costs.at(accepted);
+    if (blocks.Count() > 1) continue;
+    auto& candidates = workspace.Candidates();
+    // Candidates streamed in several passes only hold the last one
+    streamed = candidates.rows < X.extent[0];
+    if (streamed) continue;
+    auto rows = X.extent[0];
+    for (int i = 0; i < coefficients.size(); i++) {
+      copy(nn_context,
+           candidates.activations.at(accepted).at(i).Rows(0, rows),
+           workspace.activations.at(i));
+    }
+    for (int i = 0; i < workspace.pre_activations.size(); i++) {
+      copy(nn_context,
+           candidates.pre_activations.at(accepted).at(i).Rows(0, rows),
+           workspace.pre_activations.at(i));
+    }
+  }
+  if (streamed) {
     update_coefficients(
       nn_context, coefficients, coefficient_proposals, bias, bias_proposals, direction, lr);
-    forward(nn_context, coefficient_proposals, bias_proposals, activations);
-    new_cost =
-      eval_cost(nn_context, activations.back(), g, h, coefficient_proposals, total_rows, alpha);
+    auto block = workspace.View(X, g, h, 0, X.extent[0]);
+    forward(
+      nn_context, coefficient_proposals, bias_proposals, block.activations, block.pre_activations);
   }
   return std::make_tuple(lr, new_cost);
 }
@@ -446,71 +774,94 @@ std::tuple<T, T> line_search(NNContext* nn_context,
 template <typename T>
 class LBfgs {
   int m;
-  std::deque<Matrix<T>> s;
-  std::deque<Matrix<T>> y;
+  // s and y live in a ring buffer of m slots in the workspace, head is the oldest pair
+  int64_t head  = 0;
+  int64_t count = 0;
+  NNWorkspace<T>& workspace;
   bool verbose = false;
 
+  // Inner products of one history row against every history row, mirrored into the Gram matrix
+  void UpdateGram(NNContext* context, int64_t row)
+  {
+    auto gram     = workspace.gram;
+    int64_t n     = gram.extent[0];
+    auto v        = workspace.history.Rows(row, row + 1);
+    auto gram_row = Matrix<T>(gram.data + row * n, {2 * m, 1});
+    dot<false, true>(context, workspace.history, v, gram_row);
+    LaunchN(2 * m, context->stream, [=] __device__(int64_t j) { gram[{j, row}] = gram[{row, j}]; });
+  }
+
  public:
-  LBfgs(int m, bool verbose) : m(m), verbose(verbose) {}
-  void Add(Matrix<T>&& x_diff, Matrix<T>&& grad_diff)
+  LBfgs(int m, bool verbose, NNWorkspace<T>& workspace)
+    : m(m), workspace(workspace), verbose(verbose)
   {
-    if (s.size() >= m) {
-      s.pop_front();
-      y.pop_front();
+    // Unused slots take part in the history GEMV with a weight of zero
+    fill(workspace.history, 0.0);
+  }
+  void Add(NNContext* context, Matrix<T>& direction, T lr, Matrix<T>& new_grad, Matrix<T>& grad)
+  {
+    if (m == 0) return;
+    // Overwrite the oldest slot once the history is full
+    int64_t slot = (head + count) % m;
+    if (count == m) {
+      head = (head + 1) % m;
+    } else {
+      count++;
     }
-    s.push_back(x_diff);
-    y.push_back(grad_diff);
+    auto s_i = workspace.s.Rows(slot, slot + 1);
+    auto y_i = workspace.y.Rows(slot, slot + 1);
+    multiply(direction, lr, s_i);
+    subtract(new_grad, grad, y_i);
+    // Only the rows and columns of the new pair change, O(m * P) rather than O(m^2 * P)
+    UpdateGram(context, slot);
+    UpdateGram(context, m + slot);
   }
-  Matrix<T> GetDirection(NNContext* context, Matrix<T>& grad)
+  void GetDirection(NNContext* context, Matrix<T>& grad, Matrix<T>& direction)
   {
     /*
     Chen, Weizhu, Zhenghao Wang, and Jingren Zhou. "Large-scale L-BFGS using MapReduce." Advances in
     neural information processing systems 27 (2014).
     */
-    if (s.size() == 0) { return multiply(grad, T(-1.0)); }
-    // Form a matrix
-    auto b             = Matrix<T>::Create({int64_t(s.size() + y.size() + 1), grad.size()});
-    std::size_t offset = 0;
-    for (int i = 0; i < s.size(); i++) {
-      auto s_i = s.at(i);
-      EXPECT(b.extent[1] == s_i.size(), "s_i size does not match");
-      CHECK_CUDA(cudaMemcpyAsync(b.data + offset,
-                                 s_i.data,
-                                 s_i.size() * sizeof(T),
-                                 cudaMemcpyDeviceToDevice,
-                                 context->stream));
-      offset += b.extent[1];
+    if (count == 0) {
+      multiply(grad, T(-1.0), direction);
+      return;
     }
-    for (int i = 0; i < y.size(); i++) {
-      auto y_i = y.at(i);
-      EXPECT(b.extent[1] == y_i.size(), "y_i size does not match");
-      CHECK_CUDA(cudaMemcpyAsync(b.data + offset,
-                                 y_i.data,
-                                 y_i.size() * sizeof(T),
-                                 cudaMemcpyDeviceToDevice,
-                                 context->stream));
-      offset += b.extent[1];
-    }
-    CHECK_CUDA(cudaMemcpyAsync(b.data + offset,
-                               grad.data,
-                               grad.size() * sizeof(T),
-                               cudaMemcpyDeviceToDevice,
-                               context->stream));
-
-    auto B = Matrix<T>::Create({b.extent[0], b.extent[0]});
-    dot<false, true>(context, b, b, B);
-
-    // Clip values away from 0
-    LaunchN(B.size(), context->stream, [=] __device__(int64_t idx) {
-      auto& val = B.data[idx];
-      if (val >= 0.0 && val < 1e-15) { val = 1e-15; }
-      if (val < 0.0 && val > -1e-15) { val = -1e-15; }
-    });
-
-    auto delta = Matrix<T>::Create({B.extent[0], 1});
-    auto alpha = Matrix<T>::Create({B.extent[0], 1});
-    int l      = s.size();
+    // The gradient changes every iteration, refresh its row and column of the Gram matrix
+    auto gram     = workspace.gram;
+    int64_t n     = gram.extent[0];
+    auto grad_row = Matrix<T>(gram.data + 2 * m * n, {2 * m, 1});
+    dot(context, workspace.history, grad, grad_row);
+    auto grad_dot = Matrix<T>(gram.data + 2 * m * n + 2 * m, {1, 1});
+    auto grad_t   = Matrix<T>(grad.data, {1, grad.size()});
+    dot(context, grad_t, grad, grad_dot);
+
+    // Copies of the members for the device lambda
+    int l             = count;
+    int64_t num_slots = m;
+    int64_t oldest    = head;
+    auto B            = Matrix<T>(workspace.B.data, {2 * l + 1, 2 * l + 1});
+    auto delta        = Matrix<T>(workspace.delta.data, {B.extent[0], 1});
+    auto alpha        = Matrix<T>(workspace.alpha.data, {B.extent[0], 1});
+    auto weights      = workspace.history_weights;
     LaunchN(1, context->stream, [=] __device__(int64_t _) {
+      int64_t g = 2 * num_slots;
+      for (int64_t j = 0; j < g; j++) { gram[{j, g}] = gram[{g, j}]; }
+
+      // Gather B in logical order [s oldest to newest, y oldest to newest, grad]
+      auto physical = [=](int64_t i) -> int64_t {
+        if (i == 2 * l) return g;
+        return i < l ? (oldest + i) % num_slots : num_slots + (oldest + i - l) % num_slots;
+      };
+      for (int64_t i = 0; i < B.extent[0]; i++) {
+        for (int64_t j = 0; j < B.extent[1]; j++) {
+          // Clip values away from 0
+          T val = gram[{physical(i), physical(j)}];
+          if (val >= 0.0 && val < 1e-15) { val = 1e-15; }
+          if (val < 0.0 && val > -1e-15) { val = -1e-15; }
+          B[{i, j}] = val;
+        }
+      }
+
       for (int i = 0; i < delta.size() - 1; i++) { delta.data[i] = 0.0; }
       delta.data[delta.size() - 1] = -1.0;
 
@@ -530,24 +881,205 @@ class LBfgs {
         T beta = sum / B[{i, i + l}];
         delta.data[i] += alpha.data[i] - beta;
       }
+
+      for (int64_t i = 0; i < weights.size(); i++) { weights.data[i] = 0.0; }
+      for (int64_t i = 0; i < 2 * l; i++) { weights.data[physical(i)] = delta.data[i]; }
     });
 
-    auto direction = Matrix<T>::Create(grad.extent);
-    dot<true, false>(context, delta, b, direction);
+    // direction = history^T weights + delta_grad * grad
+    dot<true, false>(context, weights, workspace.history, direction);
+    auto grad_weight = delta.data + 2 * l;
+    LaunchN(grad.size(), context->stream, [=] __device__(int64_t idx) {
+      direction.data[idx] += *grad_weight * grad.data[idx];
+    });
 
     T t = vector_dot(context, grad, direction);
     if (t >= 0) {
       if (verbose)
         std::cout << "Search direction is not a descent direction. Resetting LBFGS search."
                   << std::endl;
-      s.clear();
-      y.clear();
-      return multiply(grad, T(-1.0));
+      head  = 0;
+      count = 0;
+      multiply(grad, T(-1.0), direction);
     }
-    return direction;
   }
 };
 
+// Adam or plain SGD step, grad and the moments are laid out as in NNContext::Unpack
+template <typename T>
+void minibatch_update(NNContext* nn_context,
+                      std::vector<Matrix<T>>& coefficients,
+                      std::vector<Matrix<T>>& bias,
+                      Matrix<T>& grad,
+                      Matrix<T>& first_moment,
+                      Matrix<T>& second_moment,
+                      const MiniBatchOptions& options,
+                      int64_t t)
+{
+  const T beta_1  = 0.9;
+  const T beta_2  = 0.999;
+  const T epsilon = 1e-8;
+  T lr            = options.learning_rate;
+  bool adam       = options.solver == NNSolver::kAdam;
+  if (adam) { lr *= std::sqrt(1 - std::pow(beta_2, t)) / (1 - std::pow(beta_1, t)); }
+  std::vector<Matrix<T>*> parameters;
+  for (auto& c : coefficients) parameters.push_back(&c);
+  for (auto& b : bias) parameters.push_back(&b);
+
+  int64_t offset = 0;
+  for (auto parameter : parameters) {
+    T* p       = parameter->data;
+    const T* d = grad.data + offset;
+    T* m       = first_moment.data + offset;
+    T* v       = second_moment.data + offset;
+    LaunchN(parameter->size(), nn_context->stream, [=] __device__(int64_t idx) {
+      if (adam) {
+        m[idx] = beta_1 * m[idx] + (1 - beta_1) * d[idx];
+        v[idx] = beta_2 * v[idx] + (1 - beta_2) * d[idx] * d[idx];
+        p[idx] -= lr * m[idx] / (sqrt(v[idx]) + epsilon);
+      } else {
+        p[idx] -= lr * d[idx];
+      }
+    });
+    offset += parameter->size();
+  }
+}
+
+template <typename T>
+void average_parameters(NNContext* nn_context,
+                        std::vector<Matrix<T>>& coefficients,
+                        std::vector<Matrix<T>>& bias,
+                        int64_t num_ranks)
+{
+  if (num_ranks == 1) return;
+  std::vector<Matrix<T>*> parameters;
+  for (auto& c : coefficients) parameters.push_back(&c);
+  for (auto& b : bias) parameters.push_back(&b);
+  for (auto parameter : parameters) {
+    nn_context->AllReduce(parameter->data, parameter->size());
+    multiply(*parameter, T(1.0 / num_ranks), *parameter);
+  }
+}
+
+// Copies rows[0, dst rows) of src into dst, rows is in device memory
+template <typename T>
+void gather_rows(NNContext* context, const Matrix<T>& src, const int64_t* rows, Matrix<T>& dst)
+{
+  int64_t cols = src.extent[1];
+  const T* in  = src.data;
+  T* out       = dst.data;
+  LaunchN(dst.size(), context->stream, [=] __device__(int64_t idx) {
+    out[idx] = in[rows[idx / cols] * cols + idx % cols];
+  });
+}
+
+// Averaged parameters must be identical on every rank, compares their squared norms
+template <typename T>
+void check_parameters_in_sync(NNContext* nn_context,
+                              std::vector<Matrix<T>>& coefficients,
+                              std::vector<Matrix<T>>& bias,
+                              int64_t num_ranks)
+{
+  if (num_ranks == 1) return;
+  double local = 0.0;
+  for (auto& c : coefficients) local += vector_dot(nn_context, c, c);
+  for (auto& b : bias) local += vector_dot(nn_context, b, b);
+  double total      = local;
+  double* total_ptr = nn_context->ReduceResult<double>();
+  CHECK_CUDA(cudaMemcpyAsync(
+    total_ptr, &total, sizeof(double), cudaMemcpyHostToDevice, nn_context->stream));
+  nn_context->AllReduce(total_ptr, 1);
+  CHECK_CUDA(cudaMemcpyAsync(
+    &total, total_ptr, sizeof(double), cudaMemcpyDeviceToHost, nn_context->stream));
+  CHECK_CUDA(cudaStreamSynchronize(nn_context->stream));
+  EXPECT(std::abs(total - num_ranks * local) <= 1e-6 * std::abs(total),
+         "Mini-batch parameters differ between workers.");
+}
+
+// Mini-batch training
+// With allreduce_interval 1 gradients are summed across ranks every step. Otherwise each rank
+// steps on its own batches and the parameters are averaged every allreduce_interval steps.
+template <typename T>
+void minibatch_fit(NNContext* nn_context,
+                   std::vector<Matrix<T>>& coefficients,
+                   std::vector<Matrix<T>>& bias,
+                   Matrix<T>& X,
+                   Matrix<double>& g,
+                   Matrix<double>& h,
+                   int64_t total_rows,
+                   double alpha,
+                   const MiniBatchOptions& options)
+{
+  int64_t num_ranks =
+    std::max(std::size_t(1), nn_context->legate_context.get_launch_domain().get_volume());
+  MiniBatchSchedule schedule(X.extent[0], total_rows, options.batch_size, options.seed);
+  // Rows of a batch are gathered into contiguous buffers by the epoch's order, kept on the device
+  int64_t buffer_rows = std::max(int64_t(1), schedule.local_batch_size);
+  auto X_batch        = Matrix<T>::Create({buffer_rows, X.extent[1]});
+  auto g_batch        = Matrix<double>::Create({buffer_rows, g.extent[1]});
+  auto h_batch        = Matrix<double>::Create({buffer_rows, h.extent[1]});
+  auto order          = Matrix<int64_t>::Create({std::max(int64_t(1), X.extent[0]), 1});
+  NNWorkspace<T> workspace(schedule.local_batch_size,
+                           nn_context->num_parameters,
+                           nn_context->coefficient_extents,
+                           0,
+                           nn_context->activation,
+                           0);
+  fill(workspace.ones, 1.0);
+  auto first_moment  = Matrix<T>::Create({nn_context->num_parameters, 1});
+  auto second_moment = Matrix<T>::Create({nn_context->num_parameters, 1});
+  fill(first_moment, 0.0);
+  fill(second_moment, 0.0);
+
+  bool sync_gradients = options.allreduce_interval <= 1;
+  int64_t t           = 0;
+  for (int epoch = 0; epoch < options.epochs; epoch++) {
+    schedule.Shuffle();
+    CHECK_CUDA(cudaMemcpyAsync(order.data,
+                               schedule.Order().data(),
+                               X.extent[0] * sizeof(int64_t),
+                               cudaMemcpyHostToDevice,
+                               nn_context->stream));
+    T cost = 0.0;
+    for (int64_t step = 0; step < schedule.steps_per_epoch; step++) {
+      auto [begin, end]   = schedule.Batch(step);
+      auto X_rows         = X_batch.Rows(0, end - begin);
+      auto g_rows         = g_batch.Rows(0, end - begin);
+      auto h_rows         = h_batch.Rows(0, end - begin);
+      const int64_t* rows = order.data + begin;
+      gather_rows(nn_context, X, rows, X_rows);
+      gather_rows(nn_context, g, rows, g_rows);
+      gather_rows(nn_context, h, rows, h_rows);
+      auto block = workspace.View(X_rows, g_rows, h_rows, 0, end - begin);
+      // Gradients are normalised by the rows contributing to them
+      int64_t batch_rows =
+        sync_gradients ? std::max(int64_t(1), total_rows / schedule.steps_per_epoch)
+                       : std::max(int64_t(1), end - begin);
+
+      forward(nn_context, coefficients, bias, block.activations, block.pre_activations);
+      backward(nn_context, coefficients, block, batch_rows, alpha, workspace.grad, sync_gradients);
+      if (options.verbose && step == schedule.steps_per_epoch - 1) {
+        cost = eval_cost(
+          nn_context, block.activations.back(), block.g, block.h, coefficients, batch_rows, alpha);
+      }
+      minibatch_update(
+        nn_context, coefficients, bias, workspace.grad, first_moment, second_moment, options, ++t);
+      if (!sync_gradients && t % options.allreduce_interval == 0) {
+        average_parameters(nn_context, coefficients, bias, num_ranks);
+      }
+    }
+    if (options.verbose && epoch % options.verbose == 0) {
+      logger.print() << "Epoch: " << epoch << " Last batch cost: " << cost;
+    }
+  }
+  if (!sync_gradients) {
+    if (t % options.allreduce_interval != 0) {
+      average_parameters(nn_context, coefficients, bias, num_ranks);
+    }
+    check_parameters_in_sync(nn_context, coefficients, bias, num_ranks);
+  }
+}
+
 struct build_nn_fn {
   template <typename T>
   void operator()(legate::TaskContext context)
@@ -565,6 +1097,15 @@ struct build_nn_fn {
     int32_t m        = context.scalar(3).value<int32_t>();
     int32_t max_iter = context.scalar(4).value<int32_t>();
     double alpha     = context.scalar(5).value<double>();
+    auto activation  = static_cast<Activation>(context.scalar(6).value<int32_t>());
+    MiniBatchOptions options{static_cast<NNSolver>(context.scalar(7).value<int32_t>()),
+                             context.scalar(8).value<int64_t>(),
+                             max_iter,
+                             context.scalar(9).value<double>(),
+                             context.scalar(10).value<int32_t>(),
+                             context.scalar(11).value<int32_t>(),
+                             verbose};
+    auto workspace_budget = context.scalar(12).value<int64_t>();
 
     std::vector<Matrix<T>> coefficients;
     std::vector<Matrix<T>> bias;
@@ -574,37 +1115,61 @@ struct build_nn_fn {
       bias.push_back(Matrix<T>::From1dOutputStore(context.output(i + 1).data()));
     }
 
-    NNContext nn_context(
-      context, coefficients, bias, legate::cuda::StreamPool::get_stream_pool().get_stream());
+    NNContext nn_context(context,
+                         coefficients,
+                         bias,
+                         activation,
+                         legate::cuda::StreamPool::get_stream_pool().get_stream());
 
     auto X           = Matrix<T>::Project3dStore(X_store, 2);
     Matrix<double> g = Matrix<double>::Project3dStore(g_store, 1);
     Matrix<double> h = Matrix<double>::Project3dStore(h_store, 1);
+    nn_context.profile.Add(ProfileField::kRows, X.extent[0]);
 
-    std::vector<Matrix<T>> activations({X});
-    std::vector<Matrix<T>> deltas;
-    for (const auto& c : coefficients) {
-      activations.push_back(Matrix<T>::Create({X.extent[0], c.extent[1]}));
-      deltas.push_back(Matrix<T>::Create({X.extent[0], c.extent[1]}));
+    if (options.solver != NNSolver::kLBFGS) {
+      minibatch_fit(&nn_context, coefficients, bias, X, g, h, total_rows, alpha, options);
+      nn_context.profile.Write(nn_context.stream);
+      return;
     }
 
-    LBfgs<T> lbfgs(m, verbose);
-    auto grad =
-      backward(&nn_context, coefficients, bias, activations, deltas, g, h, total_rows, alpha);
+    // Row buffers are sized to a block of rows that fits the workspace budget
+    int64_t block_rows = NNWorkspace<T>::BlockRows(workspace_budget,
+                                                   X.extent[0],
+                                                   nn_context.num_parameters,
+                                                   nn_context.coefficient_extents,
+                                                   m,
+                                                   activation,
+                                                   kLineSearchCandidates);
+    RowBlocks blocks(X.extent[0], block_rows);
+    NNWorkspace<T> workspace(block_rows,
+                             nn_context.num_parameters,
+                             nn_context.coefficient_extents,
+                             m,
+                             activation,
+                             kLineSearchCandidates);
+    fill(workspace.ones, 1.0);
+    auto grad      = workspace.grad;
+    auto new_grad  = workspace.new_grad;
+    auto direction = workspace.direction;
+
+    LBfgs<T> lbfgs(m, verbose, workspace);
+    T cost = eval_cost_blocks(
+      &nn_context, coefficients, bias, workspace, blocks, X, g, h, total_rows, alpha);
+    eval_grad(&nn_context, coefficients, bias, workspace, blocks, X, g, h, total_rows, alpha, grad);
     T grad_norm = vector_norm(&nn_context, grad);
-    T cost      = eval_cost(&nn_context, activations.back(), g, h, coefficients, total_rows, alpha);
 
     LearningMonitor monitor(max_iter, verbose, gtol);
 
     while (!monitor.IsConverged(cost, grad_norm)) {
-      auto direction      = lbfgs.GetDirection(&nn_context, grad);
+      lbfgs.GetDirection(&nn_context, grad, direction);
       auto [lr, new_cost] = line_search(&nn_context,
                                         coefficients,
                                         bias,
                                         direction,
                                         grad,
-                                        activations,
-                                        deltas,
+                                        workspace,
+                                        blocks,
+                                        X,
                                         g,
                                         h,
                                         total_rows,
@@ -613,14 +1178,55 @@ struct build_nn_fn {
       cost                = new_cost;
 
       update_coefficients(&nn_context, coefficients, coefficients, bias, bias, direction, lr);
+      eval_grad(
+        &nn_context, coefficients, bias, workspace, blocks, X, g, h, total_rows, alpha, new_grad);
 
-      auto new_grad =
-        backward(&nn_context, coefficients, bias, activations, deltas, g, h, total_rows, alpha);
-
-      lbfgs.Add(multiply(direction, lr), subtract(new_grad, grad));
-      grad      = new_grad;
+      lbfgs.Add(&nn_context, direction, lr, new_grad, grad);
+      std::swap(grad, new_grad);
       grad_norm = vector_norm(&nn_context, grad);
     }
+    nn_context.profile.Write(nn_context.stream);
+  }
+};
+
+struct predict_nn_fn {
+  template <typename T>
+  void operator()(legate::TaskContext context)
+  {
+    auto [X_store, X_shape, X_accessor] = GetInputStore<T, 3>(context.input(0).data());
+    auto pred_store                     = context.output(0).data();
+    auto pred_shape                     = pred_store.shape<3>();
+    EXPECT_AXIS_ALIGNED(0, X_shape, pred_shape);
+    auto activation = static_cast<Activation>(context.scalar(0).value<int32_t>());
+
+    std::vector<Matrix<T>> coefficients;
+    std::vector<Matrix<T>> bias;
+    for (int i = 1; i < context.num_inputs(); i += 2) {
+      EXPECT_IS_BROADCAST(context.input(i).data().shape<2>());
+      coefficients.push_back(Matrix<T>::From2dStore(context.input(i).data()));
+      bias.push_back(Matrix<T>::From1dStore(context.input(i + 1).data()));
+    }
+
+    NNContext nn_context(context,
+                         coefficients,
+                         bias,
+                         activation,
+                         legate::cuda::StreamPool::get_stream_pool().get_stream());
+
+    Matrix<T> X        = Matrix<T>::Project3dStore(X_store, 2);
+    Matrix<T> pred     = Matrix<T>::Project3dOutputStore(pred_store, 1);
+    int64_t block_rows = std::min(kPredictBlockRows, X.extent[0]);
+    PredictWorkspace<T> workspace(block_rows, nn_context.coefficient_extents);
+    std::vector<Matrix<T>> pre_activations;
+
+    // The output layer writes straight into pred
+    for (int64_t begin = 0; begin < X.extent[0]; begin += block_rows) {
+      int64_t end = std::min(begin + block_rows, X.extent[0]);
+      std::vector<Matrix<T>> activations({X.Rows(begin, end)});
+      for (auto& a : TopRows(workspace.activations, end - begin)) activations.push_back(a);
+      activations.push_back(pred.Rows(begin, end));
+      forward(&nn_context, coefficients, bias, activations, pre_activations);
+    }
   }
 };
 
@@ -631,4 +1237,10 @@ struct build_nn_fn {
   const auto& X = context.input(0).data();
   type_dispatch_float(X.code(), build_nn_fn(), context);
 }
+
+/*static*/ void PredictNNTask::gpu_variant(legate::TaskContext context)
+{
+  const auto& X = context.input(0).data();
+  type_dispatch_float(X.code(), predict_nn_fn(), context);
+}
 }  // namespace legateboost
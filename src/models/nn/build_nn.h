@@ -18,6 +18,11 @@
 #include "legate_library.h"
 #include "legateboost.h"
 #include "core/cuda/stream_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <random>
 
 namespace legateboost {
 
@@ -40,11 +45,17 @@ struct Matrix {
     return data[idx[0] * extent[1] + idx[1]];
   }
 
+  // View of rows [begin, end)
+  Matrix<T> Rows(int64_t begin, int64_t end) const
+  {
+    return Matrix<T>(data + begin * extent[1], {end - begin, extent[1]});
+  }
+
   static Matrix<T> From1dStore(legate::PhysicalStore store)
   {
     auto shape = store.shape<1>();
-    T* data    = store.read_accessor<T, 1, true>().ptr(shape.lo);
-    return Matrix<T>(data, {shape.hi[0] - shape.lo[0] + 1, 1});
+    auto data  = store.read_accessor<T, 1, true>().ptr(shape.lo);
+    return Matrix<T>(const_cast<T*>(data), {shape.hi[0] - shape.lo[0] + 1, 1});
   }
   static Matrix<T> From1dOutputStore(legate::PhysicalStore store)
   {
@@ -56,8 +67,9 @@ struct Matrix {
   static Matrix<T> From2dStore(legate::PhysicalStore store)
   {
     auto shape = store.shape<2>();
-    T* data    = store.read_accessor<T, 2, true>().ptr(shape.lo);
-    return Matrix<T>(data, {shape.hi[0] - shape.lo[0] + 1, shape.hi[1] - shape.lo[1] + 1});
+    auto data  = store.read_accessor<T, 2, true>().ptr(shape.lo);
+    return Matrix<T>(const_cast<T*>(data),
+                     {shape.hi[0] - shape.lo[0] + 1, shape.hi[1] - shape.lo[1] + 1});
   }
   static Matrix<T> From2dOutputStore(legate::PhysicalStore store)
   {
@@ -81,6 +93,20 @@ struct Matrix {
     }
     return Matrix<T>(const_cast<T*>(data), extent);
   }
+  static Matrix<T> Project3dOutputStore(legate::PhysicalStore store, int broadcast_dimension)
+  {
+    auto shape = store.shape<3>();
+    auto data  = store.write_accessor<T, 3, true>().ptr(shape.lo);
+    std::array<int64_t, 2> extent;
+    if (broadcast_dimension == 0) {
+      extent = {shape.hi[1] - shape.lo[1] + 1, shape.hi[2] - shape.lo[2] + 1};
+    } else if (broadcast_dimension == 1) {
+      extent = {shape.hi[0] - shape.lo[0] + 1, shape.hi[2] - shape.lo[2] + 1};
+    } else {
+      extent = {shape.hi[0] - shape.lo[0] + 1, shape.hi[1] - shape.lo[1] + 1};
+    }
+    return Matrix<T>(data, extent);
+  }
 
   static Matrix<T> Create(std::array<int64_t, 2> extent)
   {
@@ -97,6 +123,438 @@ struct Matrix {
   }
 };
 
+// Hidden layer activation, matches the activation argument of models.NN
+enum class Activation : std::int32_t { kTanh = 0, kReLU = 1, kLeakyReLU = 2, kSiLU = 3 };
+
+constexpr double kLeakyReLUSlope = 0.01;
+
+__host__ __device__ inline double FastTanh(double x) { return tanh(x); }
+
+// Rational approximation accurate to float precision, branch free so the host loop vectorises
+__host__ __device__ inline float FastTanh(float x)
+{
+#ifdef __CUDA_ARCH__
+  return tanhf(x);
+#else
+  const float clamp = 7.90531110763549805f;
+  x                 = x > clamp ? clamp : (x < -clamp ? -clamp : x);
+  const float x2    = x * x;
+  float p           = -2.76076847742355e-16f;
+  p                 = p * x2 + 2.00018790482477e-13f;
+  p                 = p * x2 - 8.60467152213735e-11f;
+  p                 = p * x2 + 5.12229709037114e-08f;
+  p                 = p * x2 + 1.48572235717979e-05f;
+  p                 = p * x2 + 6.37261928875436e-04f;
+  p                 = p * x2 + 4.89352455891786e-03f;
+  float q           = 1.19825839466702e-06f;
+  q                 = q * x2 + 1.18534705686654e-04f;
+  q                 = q * x2 + 2.26843463243900e-03f;
+  q                 = q * x2 + 4.89352518554385e-03f;
+  return x * p / q;
+#endif
+}
+
+// Derivative receives both the pre-activation z and the output a = f(z)
+// kNeedsPreActivation is set when the derivative cannot be recovered from a alone
+template <typename T>
+struct TanhActivation {
+  static constexpr bool kNeedsPreActivation = false;
+  __host__ __device__ static T Apply(T z) { return FastTanh(z); }
+  __host__ __device__ static T Derivative(T z, T a) { return T(1) - a * a; }
+};
+
+template <typename T>
+struct ReLUActivation {
+  static constexpr bool kNeedsPreActivation = false;
+  __host__ __device__ static T Apply(T z) { return z > T(0) ? z : T(0); }
+  __host__ __device__ static T Derivative(T z, T a) { return a > T(0) ? T(1) : T(0); }
+};
+
+template <typename T>
+struct LeakyReLUActivation {
+  static constexpr bool kNeedsPreActivation = false;
+  __host__ __device__ static T Apply(T z) { return z > T(0) ? z : T(kLeakyReLUSlope) * z; }
+  __host__ __device__ static T Derivative(T z, T a) { return a > T(0) ? T(1) : T(kLeakyReLUSlope); }
+};
+
+template <typename T>
+struct SiLUActivation {
+  static constexpr bool kNeedsPreActivation = true;
+  __host__ __device__ static T Apply(T z) { return z / (T(1) + exp(-z)); }
+  __host__ __device__ static T Derivative(T z, T a)
+  {
+    T sigmoid = T(1) / (T(1) + exp(-z));
+    return sigmoid * (T(1) + z * (T(1) - sigmoid));
+  }
+};
+
+template <typename T, typename Functor>
+void activation_dispatch(Activation activation, Functor&& f)
+{
+  switch (activation) {
+    case Activation::kTanh: f(TanhActivation<T>{}); break;
+    case Activation::kReLU: f(ReLUActivation<T>{}); break;
+    case Activation::kLeakyReLU: f(LeakyReLUActivation<T>{}); break;
+    case Activation::kSiLU: f(SiLUActivation<T>{}); break;
+    default: EXPECT(false, "Unknown activation.");
+  }
+}
+
+inline bool NeedsPreActivation(Activation activation) { return activation == Activation::kSiLU; }
+
+// Step sizes the line search evaluates together once the first step is rejected
+constexpr int kLineSearchCandidates = 3;
+
+// Rows per pass of the line search candidates, bounds their workspace
+constexpr int64_t kLineSearchBlockRows = 4096;
+
+// Rows per block in PredictNN, bounds the hidden layer workspace
+constexpr int64_t kPredictBlockRows = 4096;
+
+// Hidden layer buffers for PredictNN, one block of rows per layer in a single allocation
+template <typename T>
+class PredictWorkspace {
+  Matrix<T> storage;
+
+ public:
+  std::vector<Matrix<T>> activations;
+
+  PredictWorkspace(int64_t block_rows,
+                   const std::vector<std::array<int64_t, 2>>& coefficient_extents)
+    : storage(nullptr, {0, 0})
+  {
+    int64_t size = 0;
+    for (std::size_t i = 0; i + 1 < coefficient_extents.size(); i++) {
+      size += block_rows * coefficient_extents[i][1];
+    }
+    storage        = Matrix<T>::Create({size, 1});
+    int64_t offset = 0;
+    for (std::size_t i = 0; i + 1 < coefficient_extents.size(); i++) {
+      activations.push_back(
+        Matrix<T>(storage.data + offset, {block_rows, coefficient_extents[i][1]}));
+      offset += activations.back().size();
+    }
+  }
+};
+
+enum class NNSolver : std::int32_t { kLBFGS = 0, kAdam = 1, kSGD = 2 };
+
+struct MiniBatchOptions {
+  NNSolver solver;
+  int64_t batch_size;
+  int32_t epochs;
+  double learning_rate;
+  int32_t allreduce_interval;
+  int32_t seed;
+  int32_t verbose;
+};
+
+// Splits an epoch into ceil(total_rows / batch_size) steps, each taking its share of every rank's
+// rows so a step sees batch_size rows summed over the ranks. Every rank takes the same number of
+// steps so collectives line up. The local rows are permuted each epoch, so batches hold different
+// rows every epoch.
+class MiniBatchSchedule {
+  int64_t num_rows;
+  std::vector<int64_t> order;
+  std::mt19937 rng;
+
+ public:
+  int64_t steps_per_epoch;
+  int64_t local_batch_size;
+
+  MiniBatchSchedule(int64_t num_rows, int64_t total_rows, int64_t batch_size, int32_t seed)
+    : num_rows(num_rows), order(num_rows), rng(seed)
+  {
+    EXPECT(batch_size > 0, "Batch size must be positive.");
+    steps_per_epoch  = std::max(int64_t(1), (total_rows + batch_size - 1) / batch_size);
+    local_batch_size = (num_rows + steps_per_epoch - 1) / steps_per_epoch;
+    std::iota(order.begin(), order.end(), 0);
+  }
+
+  void Shuffle() { std::shuffle(order.begin(), order.end(), rng); }
+
+  // Local row indices in the order of the current epoch
+  const std::vector<int64_t>& Order() const { return order; }
+
+  // Range [begin, end) of Order() holding the rows of the given step
+  std::tuple<int64_t, int64_t> Batch(int64_t step) const
+  {
+    int64_t begin = std::min(step * local_batch_size, num_rows);
+    int64_t end   = std::min(begin + local_batch_size, num_rows);
+    return std::make_tuple(begin, end);
+  }
+};
+
+// Views of the first rows of each matrix, used when a batch is smaller than the workspace
+template <typename T>
+std::vector<Matrix<T>> TopRows(const std::vector<Matrix<T>>& matrices, int64_t rows)
+{
+  std::vector<Matrix<T>> result;
+  for (const auto& m : matrices) { result.push_back(m.Rows(0, rows)); }
+  return result;
+}
+
+// Row blocks of the local shard streamed through the forward and backward passes of BuildNN
+// A single block covers every row unless the workspace has a memory budget
+class RowBlocks {
+  int64_t num_rows;
+  int64_t block_rows;
+
+ public:
+  RowBlocks(int64_t num_rows, int64_t block_rows) : num_rows(num_rows), block_rows(block_rows) {}
+
+  // Always at least one block so every rank joins the same collectives
+  int64_t Count() const
+  {
+    if (block_rows == 0) return 1;
+    return std::max(int64_t(1), (num_rows + block_rows - 1) / block_rows);
+  }
+
+  // Row range [begin, end) of the given block
+  std::tuple<int64_t, int64_t> Bounds(int64_t i) const
+  {
+    int64_t begin = std::min(i * block_rows, num_rows);
+    int64_t end   = std::min(begin + block_rows, num_rows);
+    return std::make_tuple(begin, end);
+  }
+};
+
+// Scratch memory for the line search candidates, only needed once a first step is rejected
+// Row buffers hold one pass of at most kLineSearchBlockRows rows
+template <typename T>
+class CandidateWorkspace {
+  Matrix<T> storage;
+  int64_t offset = 0;
+
+  Matrix<T> Carve(std::array<int64_t, 2> extent)
+  {
+    auto result = Matrix<T>(storage.data + offset, extent);
+    offset += result.size();
+    EXPECT(offset <= storage.size(), "NN workspace exhausted");
+    return result;
+  }
+
+ public:
+  int64_t rows;
+  // Candidate layers, indexed [candidate][layer], excluding the input layer
+  std::vector<std::vector<Matrix<T>>> activations;
+  std::vector<std::vector<Matrix<T>>> pre_activations;
+  Matrix<T> stacked_weights;  // [W | direction] of the first layer
+  Matrix<T> stacked_output;   // X [W | direction]
+
+  static int64_t RequiredSize(int64_t num_rows,
+                              const std::vector<std::array<int64_t, 2>>& coefficient_extents,
+                              Activation activation,
+                              int64_t candidates)
+  {
+    int64_t size = 0;
+    for (std::size_t i = 0; i < coefficient_extents.size(); i++) {
+      size += candidates * num_rows * coefficient_extents[i][1];
+      if (NeedsPreActivation(activation) && i + 1 < coefficient_extents.size()) {
+        size += candidates * num_rows * coefficient_extents[i][1];
+      }
+    }
+    const auto& first = coefficient_extents.front();
+    size += first[0] * 2 * first[1] + num_rows * 2 * first[1];
+    return size;
+  }
+
+  CandidateWorkspace(int64_t rows,
+                     const std::vector<std::array<int64_t, 2>>& coefficient_extents,
+                     Activation activation,
+                     int64_t candidates)
+    : storage(Matrix<T>::Create(
+        {RequiredSize(rows, coefficient_extents, activation, candidates), 1})),
+      rows(rows),
+      stacked_weights(nullptr, {0, 0}),
+      stacked_output(nullptr, {0, 0})
+  {
+    for (int64_t j = 0; j < candidates; j++) {
+      activations.emplace_back();
+      pre_activations.emplace_back();
+      for (std::size_t i = 0; i < coefficient_extents.size(); i++) {
+        activations.back().push_back(Carve({rows, coefficient_extents[i][1]}));
+        if (NeedsPreActivation(activation) && i + 1 < coefficient_extents.size()) {
+          pre_activations.back().push_back(Carve({rows, coefficient_extents[i][1]}));
+        }
+      }
+    }
+    const auto& first = coefficient_extents.front();
+    stacked_weights   = Carve({first[0], 2 * first[1]});
+    stacked_output    = Carve({rows, 2 * first[1]});
+  }
+};
+
+// Scratch memory for BuildNN
+// Everything the L-BFGS loop needs is sized once from the layer extents and carved out of a
+// single allocation, so iterations do not touch the allocator. Row buffers hold one block of rows.
+// The line search candidates are allocated once, on the first iteration that needs them.
+template <typename T>
+class NNWorkspace {
+  Matrix<T> storage;
+  int64_t offset = 0;
+
+  static int64_t RequiredSize(int64_t num_rows,
+                              int64_t num_parameters,
+                              const std::vector<std::array<int64_t, 2>>& coefficient_extents,
+                              int64_t m,
+                              Activation activation,
+                              int64_t candidates)
+  {
+    int64_t size = 0;
+    // activations and deltas
+    for (const auto& extent : coefficient_extents) { size += 2 * num_rows * extent[1]; }
+    // hidden layer pre-activations
+    if (NeedsPreActivation(activation)) {
+      for (std::size_t i = 0; i + 1 < coefficient_extents.size(); i++) {
+        size += num_rows * coefficient_extents[i][1];
+      }
+    }
+    // grad, new_grad, direction, proposal
+    size += 4 * num_parameters;
+    // ones vector for bias gradients
+    size += num_rows;
+    // s and y history
+    size += 2 * m * num_parameters;
+    // Gram matrix, B, delta, alpha and history weights for the vector-free recursion
+    size += 2 * (2 * m + 1) * (2 * m + 1) + 2 * (2 * m + 1) + 2 * m;
+    return size;
+  }
+
+  Matrix<T> Carve(std::array<int64_t, 2> extent)
+  {
+    auto result = Matrix<T>(storage.data + offset, extent);
+    offset += result.size();
+    EXPECT(offset <= storage.size(), "NN workspace exhausted");
+    return result;
+  }
+
+  std::vector<std::array<int64_t, 2>> coefficient_extents;
+  Activation activation;
+  int64_t num_candidates;
+  int64_t candidate_rows;
+  std::unique_ptr<CandidateWorkspace<T>> candidates;
+
+ public:
+  std::vector<Matrix<T>> activations;  // Excludes the input layer
+  std::vector<Matrix<T>> deltas;
+  std::vector<Matrix<T>> pre_activations;  // Hidden layers only, empty if not needed
+  Matrix<T> grad;
+  Matrix<T> new_grad;
+  Matrix<T> direction;
+  Matrix<T> proposal;
+  Matrix<T> ones;
+  Matrix<T> history;  // [s; y], 2m x num_parameters
+  Matrix<T> s;        // m x num_parameters ring buffer
+  Matrix<T> y;        // m x num_parameters ring buffer
+  Matrix<T> gram;     // Inner products of the history slots and the gradient
+  Matrix<T> B;
+  Matrix<T> delta;
+  Matrix<T> alpha;
+  Matrix<T> history_weights;
+
+  // Views of the workspace for rows [begin, end) of the input, activations.front() is the input
+  struct Block {
+    std::vector<Matrix<T>> activations;
+    std::vector<Matrix<T>> pre_activations;
+    std::vector<Matrix<T>> deltas;
+    Matrix<T> ones;
+    Matrix<double> g;
+    Matrix<double> h;
+  };
+
+  // Largest block of rows whose workspace fits in budget_bytes, a budget <= 0 is unlimited
+  // Everything sized by the parameters and the line search candidates is fixed, so a budget below
+  // that still gets one row
+  static int64_t BlockRows(int64_t budget_bytes,
+                           int64_t num_rows,
+                           int64_t num_parameters,
+                           const std::vector<std::array<int64_t, 2>>& coefficient_extents,
+                           int64_t m,
+                           Activation activation,
+                           int64_t candidates)
+  {
+    if (budget_bytes <= 0) return num_rows;
+    int64_t fixed =
+      RequiredSize(0, num_parameters, coefficient_extents, m, activation, candidates);
+    if (candidates > 0) {
+      fixed += CandidateWorkspace<T>::RequiredSize(
+        std::min(num_rows, kLineSearchBlockRows), coefficient_extents, activation, candidates);
+    }
+    int64_t per_row =
+      RequiredSize(1, num_parameters, coefficient_extents, m, activation, candidates) -
+      RequiredSize(0, num_parameters, coefficient_extents, m, activation, candidates);
+    int64_t rows = (budget_bytes / int64_t(sizeof(T)) - fixed) / per_row;
+    return std::clamp(rows, std::min(int64_t(1), num_rows), num_rows);
+  }
+
+  Block View(const Matrix<T>& X,
+             const Matrix<double>& g,
+             const Matrix<double>& h,
+             int64_t begin,
+             int64_t end) const
+  {
+    int64_t rows = end - begin;
+    std::vector<Matrix<T>> block_activations({X.Rows(begin, end)});
+    for (auto& a : TopRows(activations, rows)) block_activations.push_back(a);
+    return Block{block_activations,
+                 TopRows(pre_activations, rows),
+                 TopRows(deltas, rows),
+                 Matrix<T>(ones.data, {1, rows}),
+                 g.Rows(begin, end),
+                 h.Rows(begin, end)};
+  }
+
+  NNWorkspace(int64_t num_rows,
+              int64_t num_parameters,
+              const std::vector<std::array<int64_t, 2>>& coefficient_extents,
+              int64_t m,
+              Activation activation,
+              int64_t candidates)
+    : storage(Matrix<T>::Create(
+        {RequiredSize(num_rows, num_parameters, coefficient_extents, m, activation, candidates),
+         1})),
+      coefficient_extents(coefficient_extents),
+      activation(activation),
+      num_candidates(candidates),
+      candidate_rows(std::min(num_rows, kLineSearchBlockRows)),
+      grad(Carve({num_parameters, 1})),
+      new_grad(Carve({num_parameters, 1})),
+      direction(Carve({num_parameters, 1})),
+      proposal(Carve({num_parameters, 1})),
+      ones(Carve({1, num_rows})),
+      history(Carve({2 * m, num_parameters})),
+      s(history.Rows(0, m)),
+      y(history.Rows(m, 2 * m)),
+      gram(Carve({2 * m + 1, 2 * m + 1})),
+      B(Carve({2 * m + 1, 2 * m + 1})),
+      delta(Carve({2 * m + 1, 1})),
+      alpha(Carve({2 * m + 1, 1})),
+      history_weights(Carve({2 * m, 1}))
+  {
+    for (const auto& extent : coefficient_extents) {
+      activations.push_back(Carve({num_rows, extent[1]}));
+      deltas.push_back(Carve({num_rows, extent[1]}));
+    }
+    if (NeedsPreActivation(activation)) {
+      for (std::size_t i = 0; i + 1 < coefficient_extents.size(); i++) {
+        pre_activations.push_back(Carve({num_rows, coefficient_extents[i][1]}));
+      }
+    }
+  }
+
+  // Allocated the first time the line search rejects its first step
+  CandidateWorkspace<T>& Candidates()
+  {
+    EXPECT(num_candidates > 0, "NN workspace has no line search candidates");
+    if (!candidates) {
+      candidates = std::make_unique<CandidateWorkspace<T>>(
+        std::max(candidate_rows, int64_t(1)), coefficient_extents, activation, num_candidates);
+    }
+    return *candidates;
+  }
+};
+
 class LearningMonitor {
   const int max_iter;
   const int max_iterations_no_progress = 5;
@@ -156,4 +614,12 @@ class BuildNNTask : public Task<BuildNNTask, BUILD_NN> {
 #endif
 };
 
+class PredictNNTask : public Task<PredictNNTask, PREDICT_NN> {
+ public:
+  static void cpu_variant(legate::TaskContext context);
+#ifdef LEGATEBOOST_USE_CUDA
+  static void gpu_variant(legate::TaskContext context);
+#endif
+};
+
 }  // namespace legateboost
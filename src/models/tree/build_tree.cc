@@ -18,7 +18,10 @@
 #include "legateboost.h"
 #include "../../cpp_utils/cpp_utils.h"
 #include "build_tree.h"
+#include <future>
+#include <limits>
 #include <random>
+#include <thread>
 
 namespace legateboost {
 
@@ -103,7 +106,145 @@ void WriteTreeOutput(legate::TaskContext context, const Tree& tree)
   WriteOutput(context.output(4).data(), tree.hessian);
 }
 
+// Calls communicate(i) for each chunk in order on the calling thread, and process(i) on a helper
+// thread as soon as communicate(i) has returned, so that earlier chunks are processed while later
+// ones are in flight. Collectives are only issued from the task thread, in the same order on every
+// rank, and process(i) must only touch the data of chunk i.
+// If process throws, the remaining chunks are still communicated so other ranks do not block.
+template <typename CommunicateFn, typename ProcessFn>
+void PipelineChunks(int num_chunks, bool overlap, CommunicateFn communicate, ProcessFn process)
+{
+  if (!overlap || num_chunks == 1) {
+    for (int i = 0; i < num_chunks; i++) {
+      communicate(i);
+      process(i);
+    }
+    return;
+  }
+  std::vector<std::promise<void>> communicated(num_chunks);
+  std::vector<std::future<void>> ready;
+  for (auto& promise : communicated) { ready.push_back(promise.get_future()); }
+  std::exception_ptr process_error;
+  std::thread process_thread([&] {
+    try {
+      for (int i = 0; i < num_chunks; i++) {
+        ready[i].get();
+        process(i);
+      }
+    } catch (...) {
+      process_error = std::current_exception();
+    }
+  });
+  int i = 0;
+  try {
+    for (; i < num_chunks; i++) {
+      communicate(i);
+      communicated[i].set_value();
+    }
+  } catch (...) {
+    for (; i < num_chunks; i++) { communicated[i].set_exception(std::current_exception()); }
+    process_thread.join();
+    throw;
+  }
+  process_thread.join();
+  if (process_error) { std::rethrow_exception(process_error); }
+}
+
+// Sends the non-empty bins as (index, value) pairs with values of type V, then sums every worker's
+// pairs into bins
+template <typename V>
+void SparseExchangeHistogram(legate::comm::coll::CollComm comm_ptr,
+                             const std::vector<int32_t>& non_empty,
+                             GPair* bins,
+                             int64_t num_bins)
+{
+  size_t num_ranks      = non_empty.size();
+  int32_t max_non_empty = *std::max_element(non_empty.begin(), non_empty.end());
+  std::vector<int32_t> send_index(max_non_empty);
+  std::vector<V> send_value(max_non_empty * 2);
+  int32_t n = 0;
+  for (int64_t i = 0; i < num_bins; i++) {
+    if (bins[i].grad == 0.0 && bins[i].hess == 0.0) continue;
+    send_index[n]         = i;
+    send_value[n * 2]     = bins[i].grad;
+    send_value[n * 2 + 1] = bins[i].hess;
+    n++;
+  }
+
+  std::vector<int32_t> recv_index(max_non_empty * num_ranks);
+  std::vector<V> recv_value(max_non_empty * 2 * num_ranks);
+  auto result = legate::comm::coll::collAllgather(
+    send_index.data(), recv_index.data(), max_non_empty, CollType<int32_t>(), comm_ptr);
+  EXPECT(result == legate::comm::coll::CollSuccess, "CPU communicator failed.");
+  result = legate::comm::coll::collAllgather(
+    send_value.data(), recv_value.data(), max_non_empty * 2, CollType<V>(), comm_ptr);
+  EXPECT(result == legate::comm::coll::CollSuccess, "CPU communicator failed.");
+
+  // Sum in rank order so every worker ends up with identical bins
+  std::fill(bins, bins + num_bins, GPair{0.0, 0.0});
+  for (size_t r = 0; r < num_ranks; r++) {
+    for (int32_t k = 0; k < non_empty[r]; k++) {
+      auto idx = r * max_non_empty + k;
+      bins[recv_index[idx]] += GPair{recv_value[idx * 2], recv_value[idx * 2 + 1]};
+    }
+  }
+}
+
+// Sums histogram bins over workers in the format selected by exchange
+// Adds the bytes each worker sends in that format to the profile
+void ExchangeHistogram(legate::TaskContext context,
+                       HistogramExchange exchange,
+                       GPair* bins,
+                       int64_t num_bins,
+                       TaskProfile& profile)
+{
+  static_assert(sizeof(GPair) == 2 * sizeof(double), "GPair must be 2 doubles");
+  auto domain      = context.get_launch_domain();
+  size_t num_ranks = domain.get_volume();
+  if (exchange == HistogramExchange::kDense || num_ranks == 1 ||
+      context.num_communicators() == 0) {
+    profile.Add(ProfileField::kBytesReduced, num_bins * sizeof(GPair));
+    SumAllReduce(context, reinterpret_cast<double*>(bins), num_bins * 2);
+    return;
+  }
+  EXPECT(num_bins <= std::numeric_limits<int32_t>::max(), "Histogram chunk too large.");
+  auto comm_ptr = context.communicator(0).get<legate::comm::coll::CollComm>();
+  EXPECT(comm_ptr != nullptr, "CPU communicator is null.");
+
+  int32_t local_non_empty = std::count_if(
+    bins, bins + num_bins, [](const GPair& b) { return b.grad != 0.0 || b.hess != 0.0; });
+  std::vector<int32_t> non_empty(num_ranks);
+  auto result = legate::comm::coll::collAllgather(
+    &local_non_empty, non_empty.data(), 1, CollType<int32_t>(), comm_ptr);
+  EXPECT(result == legate::comm::coll::CollSuccess, "CPU communicator failed.");
+  int32_t max_non_empty = *std::max_element(non_empty.begin(), non_empty.end());
+  profile.Add(ProfileField::kBytesReduced, sizeof(int32_t));
+
+  bool use_float32   = exchange == HistogramExchange::kFloat32;
+  size_t value_bytes = use_float32 ? sizeof(float) : sizeof(double);
+  if (UseSparseHistogram(num_bins, max_non_empty, num_ranks, value_bytes)) {
+    profile.Add(ProfileField::kBytesReduced, max_non_empty * (sizeof(int32_t) + 2 * value_bytes));
+    if (use_float32) {
+      SparseExchangeHistogram<float>(comm_ptr, non_empty, bins, num_bins);
+    } else {
+      SparseExchangeHistogram<double>(comm_ptr, non_empty, bins, num_bins);
+    }
+  } else if (use_float32) {
+    profile.Add(ProfileField::kBytesReduced, num_bins * 2 * sizeof(float));
+    std::vector<float> values(num_bins * 2);
+    auto ptr = reinterpret_cast<double*>(bins);
+    std::copy(ptr, ptr + num_bins * 2, values.begin());
+    SumAllReduce(context, values.data(), num_bins * 2);
+    std::copy(values.begin(), values.end(), ptr);
+  } else {
+    profile.Add(ProfileField::kBytesReduced, num_bins * sizeof(GPair));
+    SumAllReduce(context, reinterpret_cast<double*>(bins), num_bins * 2);
+  }
+}
+
 // Randomly sample split_samples rows from X
+// Every worker draws the same rows from the shared seed and reads the ones it owns, so the samples
+// do not depend on how rows are partitioned
 // Share the samples with all workers
 // Remove any duplicates
 // Return sparse matrix of split samples for each feature
@@ -113,26 +254,35 @@ SparseSplitProposals<T> SelectSplitSamples(legate::TaskContext context,
                                            legate::Rect<3> X_shape,
                                            int split_samples,
                                            int seed,
-                                           int64_t dataset_rows)
+                                           int64_t dataset_rows,
+                                           bool feature_parallel,
+                                           TaskProfile& profile)
 {
-  std::vector<int64_t> row_samples(split_samples);
-
+  int num_features = X_shape.hi[1] - X_shape.lo[1] + 1;
   std::default_random_engine eng(seed);
   std::uniform_int_distribution<int64_t> dist(0, dataset_rows - 1);
-  std::transform(row_samples.begin(), row_samples.end(), row_samples.begin(), [&dist, &eng](int) {
-    return dist(eng);
-  });
-
-  int num_features     = X_shape.hi[1] - X_shape.lo[1] + 1;
-  auto draft_proposals = legate::create_buffer<T, 2>({num_features, split_samples});
+  std::vector<T> local_rows;
+  std::vector<int32_t> slots;
   for (int i = 0; i < split_samples; i++) {
-    auto row      = row_samples[i];
-    bool has_data = row >= X_shape.lo[0] && row <= X_shape.hi[0];
+    auto row = dist(eng);
+    if (row < X_shape.lo[0] || row > X_shape.hi[0]) continue;
+    slots.push_back(i);
     for (int j = 0; j < num_features; j++) {
-      draft_proposals[{j, i}] = has_data ? X[{row, j, 0}] : T(0);
+      local_rows.push_back(X[{row, X_shape.lo[1] + j, 0}]);
     }
   }
-  SumAllReduce(context, draft_proposals.ptr({0, 0}), num_features * split_samples);
+  int local_samples = slots.size();
+
+  // [split_samples, num_features]
+  // With features partitioned every worker already holds all rows of its own features
+  std::vector<T> samples(split_samples * num_features);
+  if (feature_parallel) {
+    samples = std::move(local_rows);
+  } else {
+    profile.Add(ProfileField::kBytesReduced, local_rows.size() * sizeof(T));
+    AllGatherRows(
+      context, local_rows.data(), slots.data(), local_samples, num_features, samples.data());
+  }
 
   // Sort samples
   std::vector<T> split_proposals_tmp;
@@ -140,8 +290,8 @@ SparseSplitProposals<T> SelectSplitSamples(legate::TaskContext context,
   auto row_pointers = legate::create_buffer<int32_t, 1>({num_features + 1});
   row_pointers[0]   = 0;
   for (int j = 0; j < num_features; j++) {
-    auto ptr = draft_proposals.ptr({j, 0});
-    std::set<T> unique(ptr, ptr + split_samples);
+    std::set<T> unique;
+    for (int i = 0; i < split_samples; i++) { unique.insert(samples[i * num_features + j]); }
     row_pointers[j + 1] = row_pointers[j] + unique.size();
     split_proposals_tmp.insert(split_proposals_tmp.end(), unique.begin(), unique.end());
   }
@@ -158,55 +308,221 @@ struct TreeBuilder {
               int32_t num_features,
               int32_t num_outputs,
               int32_t max_nodes,
-              SparseSplitProposals<T> split_proposals)
+              int32_t histogram_chunks,
+              HistogramExchange histogram_exchange,
+              int32_t feature_offset,
+              bool feature_parallel,
+              int32_t voting_top_k,
+              SparseSplitProposals<T> split_proposals,
+              TaskProfile& profile)
     : num_rows(num_rows),
       num_features(num_features),
       num_outputs(num_outputs),
       max_nodes(max_nodes),
+      histogram_chunks(histogram_chunks),
+      histogram_exchange(histogram_exchange),
+      feature_offset(feature_offset),
+      feature_parallel(feature_parallel),
+      voting_top_k(voting_top_k),
       split_proposals(split_proposals),
+      profile(profile),
       histogram_buffer(
         legate::create_buffer<GPair, 3>({max_nodes, split_proposals.histogram_size, num_outputs})),
       positions(num_rows, 0)
   {
+    if (voting_top_k > 0) { local_node_sums.resize(max_nodes * num_outputs); }
     auto ptr = histogram_buffer.ptr({0, 0, 0});
     std::fill(ptr, ptr + max_nodes * split_proposals.histogram_size * num_outputs, GPair{0.0, 0.0});
   }
   ~TreeBuilder() { histogram_buffer.destroy(); }
-  template <typename TYPE>
+  template <typename TYPE, typename Policy>
   void ComputeHistogram(int depth,
                         legate::TaskContext context,
                         Tree& tree,
                         legate::AccessorRO<TYPE, 3> X,
                         legate::Rect<3> X_shape,
                         legate::AccessorRO<double, 3> g,
-                        legate::AccessorRO<double, 3> h)
+                        legate::AccessorRO<double, 3> h,
+                        Policy& policy)
   {
+    if (UseVoting(context)) {
+      for (int64_t i = X_shape.lo[0]; i <= X_shape.hi[0]; i++) {
+        auto position = positions[i - X_shape.lo[0]];
+        if (position < 0) continue;
+        for (int64_t k = 0; k < num_outputs; ++k) {
+          local_node_sums[position * num_outputs + k] += GPair{g[{i, 0, k}], h[{i, 0, k}]};
+        }
+      }
+    }
     // Build the histogram
-    for (int64_t i = X_shape.lo[0]; i <= X_shape.hi[0]; i++) {
-      auto index_local = i - X_shape.lo[0];
-      auto position    = positions[index_local];
-      bool compute     = ComputeHistogramBin(position, depth, tree.hessian);
-      if (position < 0 || !compute) continue;
-      for (int64_t j = 0; j < num_features; j++) {
-        auto x_value = X[{i, j, 0}];
-        int bin_idx  = split_proposals.FindBin(x_value, j);
-
-        if (bin_idx != SparseSplitProposals<T>::NOT_FOUND) {
-          for (int64_t k = 0; k < num_outputs; ++k) {
-            histogram_buffer[{position, bin_idx, k}] += GPair{g[{i, 0, k}], h[{i, 0, k}]};
+    // Each thread fills the bins of its own block of features, so every bin is summed in row order
+    // whatever the number of threads
+    int num_blocks = std::max(std::min(PolicyThreads(policy), num_features), 1);
+    thrust::for_each_n(policy, thrust::make_counting_iterator<int>(0), num_blocks, [&](int block) {
+      int64_t feature_begin = int64_t(num_features) * block / num_blocks;
+      int64_t feature_end   = int64_t(num_features) * (block + 1) / num_blocks;
+      for (int64_t i = X_shape.lo[0]; i <= X_shape.hi[0]; i++) {
+        auto position = positions[i - X_shape.lo[0]];
+        bool compute  = ComputeHistogramBin(position, depth, tree.hessian);
+        if (position < 0 || !compute) continue;
+        for (int64_t j = feature_begin; j < feature_end; j++) {
+          auto x_value = X[{i, feature_offset + j, 0}];
+          int bin_idx  = split_proposals.FindBin(x_value, j);
+
+          if (bin_idx != SparseSplitProposals<T>::NOT_FOUND) {
+            for (int64_t k = 0; k < num_outputs; ++k) {
+              histogram_buffer[{position, bin_idx, k}] += GPair{g[{i, 0, k}], h[{i, 0, k}]};
+            }
+          }
+        }
+      }
+    });
+  }
+
+  // Sums the level histogram over workers in chunks of nodes
+  // Each chunk is scanned and searched for splits while the following chunks are being reduced
+  // With features partitioned the histograms are already complete and nothing is sent
+  void ReduceScanAndSplit(int depth, legate::TaskContext context, Tree& tree, double alpha)
+  {
+    if (UseVoting(context)) {
+      this->VotingScanAndSplit(depth, context, tree, alpha);
+      return;
+    }
+    LevelChunks chunks(depth, histogram_chunks);
+    bool multi_rank = context.get_launch_domain().get_volume() > 1;
+    PipelineChunks(
+      chunks.Count(),
+      multi_rank && !feature_parallel,
+      [&](int chunk) {
+        if (feature_parallel) return;
+        auto [node_begin, node_end] = chunks.Nodes(chunk);
+        auto num_bins = (node_end - node_begin) * split_proposals.histogram_size * num_outputs;
+        profile.Time(ProfileField::kAllReduce, [&] {
+          ExchangeHistogram(context,
+                            histogram_exchange,
+                            histogram_buffer.ptr({node_begin, 0, 0}),
+                            num_bins,
+                            profile);
+        });
+      },
+      [&](int chunk) {
+        auto [node_begin, node_end] = chunks.Nodes(chunk);
+        profile.Time(ProfileField::kScan, [&] { this->Scan(depth, node_begin, node_end, tree); });
+        profile.Time(ProfileField::kSplitEvaluation,
+                     [&] { this->PerformBestSplit(node_begin, node_end, tree, alpha); });
+        profile.Add(ProfileField::kBins,
+                    (node_end - node_begin) * split_proposals.histogram_size * num_outputs);
+      });
+  }
+
+  // Voting is only worth it when fewer features are reduced than there are
+  bool UseVoting(legate::TaskContext context) const
+  {
+    return voting_top_k > 0 && 2 * voting_top_k < num_features &&
+           context.get_launch_domain().get_volume() > 1 && context.num_communicators() > 0;
+  }
+
+  // The voting_top_k features with the highest gain on this worker's histogram, for each node of a
+  // level, padded with -1
+  std::vector<int32_t> NominateFeatures(int node_begin, int num_nodes, double alpha)
+  {
+    std::vector<int32_t> votes(num_nodes * voting_top_k, -1);
+    std::vector<std::pair<double, int32_t>> ranked(num_features);  // (-gain, feature)
+    for (int k = 0; k < num_nodes; k++) {
+      int node_id = node_begin + k;
+      for (int feature = 0; feature < num_features; feature++) {
+        auto [feature_begin, feature_end] = split_proposals.FeatureRange(feature);
+        double best_gain                  = 0.0;
+        for (int bin_idx = feature_begin; bin_idx < feature_end; bin_idx++) {
+          double gain = 0.0;
+          for (int output = 0; output < num_outputs; output++) {
+            auto [G_L, H_L] = histogram_buffer[{node_id, bin_idx, output}];
+            auto [G, H]     = local_node_sums[node_id * num_outputs + output];
+            gain += CalculateSplitGain(G_L, H_L, G, H, alpha);
           }
+          best_gain = std::max(best_gain, gain);
         }
+        ranked[feature] = {-best_gain, feature};
+      }
+      std::partial_sort(ranked.begin(), ranked.begin() + voting_top_k, ranked.end());
+      for (int s = 0; s < voting_top_k; s++) {
+        if (ranked[s].first < 0.0) { votes[k * voting_top_k + s] = ranked[s].second; }
       }
     }
+    return votes;
+  }
+
+  // Voting parallel split search for row partitioned data with many features
+  // Each worker nominates the voting_top_k features of each node with the highest gain on its local
+  // histogram. Only the histograms of the 2 * voting_top_k features with the most votes are summed
+  // over workers, so the bytes sent per level do not depend on the number of features.
+  void VotingScanAndSplit(int depth, legate::TaskContext context, Tree& tree, double alpha)
+  {
+    int node_begin = BinaryTree::LevelBegin(depth);
+    int num_nodes  = BinaryTree::NodesInLevel(depth);
+    profile.Time(ProfileField::kScan,
+                 [&] { this->Scan(depth, node_begin, node_begin + num_nodes, tree); });
 
-    SumAllReduce(
-      context,
-      reinterpret_cast<double*>(histogram_buffer.ptr({BinaryTree::LevelBegin(depth), 0, 0})),
-      BinaryTree::NodesInLevel(depth) * split_proposals.histogram_size * num_outputs * 2);
-    this->Scan(depth, tree);
+    auto votes = profile.Time(ProfileField::kSplitEvaluation,
+                              [&] { return this->NominateFeatures(node_begin, num_nodes, alpha); });
+
+    size_t num_ranks = context.get_launch_domain().get_volume();
+    auto comm_ptr    = context.communicator(0).get<legate::comm::coll::CollComm>();
+    EXPECT(comm_ptr != nullptr, "CPU communicator is null.");
+    std::vector<int32_t> all_votes(votes.size() * num_ranks);
+    profile.Add(ProfileField::kBytesReduced, votes.size() * sizeof(int32_t));
+    auto result = profile.Time(ProfileField::kAllReduce, [&] {
+      return legate::comm::coll::collAllgather(
+        votes.data(), all_votes.data(), votes.size(), CollType<int32_t>(), comm_ptr);
+    });
+    EXPECT(result == legate::comm::coll::CollSuccess, "CPU communicator failed.");
+    auto selected    = SelectVotedFeatures(all_votes, num_ranks, num_nodes, voting_top_k);
+    int num_selected = 2 * voting_top_k;
+
+    // Pack the selected features of each node, each padded to the largest number of bins
+    int max_bins = 0;
+    for (int feature = 0; feature < num_features; feature++) {
+      auto [feature_begin, feature_end] = split_proposals.FeatureRange(feature);
+      max_bins                          = std::max(max_bins, feature_end - feature_begin);
+    }
+    std::vector<GPair> packed(num_nodes * num_selected * max_bins * num_outputs);
+    auto for_each_selected_bin = [&](auto fn) {
+      for (int slot = 0; slot < num_nodes * num_selected; slot++) {
+        if (selected[slot] < 0) continue;
+        auto [feature_begin, feature_end] = split_proposals.FeatureRange(selected[slot]);
+        for (int bin_idx = feature_begin; bin_idx < feature_end; bin_idx++) {
+          for (int output = 0; output < num_outputs; output++) {
+            auto packed_idx = (slot * max_bins + bin_idx - feature_begin) * num_outputs + output;
+            fn(node_begin + slot / num_selected, bin_idx, output, packed[packed_idx]);
+          }
+        }
+      }
+    };
+    for_each_selected_bin([&](int node_id, int bin_idx, int output, GPair& packed_bin) {
+      packed_bin = histogram_buffer[{node_id, bin_idx, output}];
+    });
+    profile.Add(ProfileField::kBytesReduced, packed.size() * sizeof(GPair));
+    profile.Time(ProfileField::kAllReduce, [&] {
+      SumAllReduce(context, reinterpret_cast<double*>(packed.data()), packed.size() * 2);
+    });
+
+    // Search the summed bins only. Bins of other features are zeroed, which gives them no gain.
+    // The local histograms are restored afterwards because the next level subtracts from them.
+    auto level      = histogram_buffer.ptr({node_begin, 0, 0});
+    auto level_size = num_nodes * split_proposals.histogram_size * num_outputs;
+    std::vector<GPair> local(level, level + level_size);
+    std::fill(level, level + level_size, GPair{0.0, 0.0});
+    for_each_selected_bin([&](int node_id, int bin_idx, int output, GPair& packed_bin) {
+      histogram_buffer[{node_id, bin_idx, output}] = packed_bin;
+    });
+    profile.Time(ProfileField::kSplitEvaluation,
+                 [&] { this->PerformBestSplit(node_begin, node_begin + num_nodes, tree, alpha); });
+    profile.Add(ProfileField::kBins, level_size);
+    std::copy(local.begin(), local.end(), level);
   }
 
-  void Scan(int depth, Tree& tree)
+  // Scans the histograms of nodes [node_begin, node_end) in the given level
+  void Scan(int depth, int node_begin, int node_end, Tree& tree)
   {
     auto scan_node_histogram = [&](int node_idx) {
       for (int feature = 0; feature < num_features; feature++) {
@@ -240,18 +556,16 @@ struct TreeBuilder {
       return;
     }
 
-    for (int parent_id = BinaryTree::LevelBegin(depth - 1);
-         parent_id < BinaryTree::LevelBegin(depth - 1) + BinaryTree::NodesInLevel(depth - 1);
+    for (int parent_id = BinaryTree::Parent(node_begin); parent_id < BinaryTree::Parent(node_end);
          parent_id++) {
       auto [histogram_node_idx, subtract_node_idx] = SelectHistogramNode(parent_id, tree.hessian);
       scan_node_histogram(histogram_node_idx);
       subtract_node_histogram(subtract_node_idx, histogram_node_idx, parent_id);
     }
   }
-  void PerformBestSplit(int depth, Tree& tree, double alpha)
+  void PerformBestSplit(int node_begin, int node_end, Tree& tree, double alpha)
   {
-    for (int node_id = BinaryTree::LevelBegin(depth); node_id < BinaryTree::LevelBegin(depth + 1);
-         node_id++) {
+    for (int node_id = node_begin; node_id < node_end; node_id++) {
       double best_gain = 0;
       int best_feature = -1;
       int best_bin     = -1;
@@ -263,11 +577,7 @@ struct TreeBuilder {
             auto [G_L, H_L] = histogram_buffer[{node_id, bin_idx, output}];
             auto G          = tree.gradient[{node_id, output}];
             auto H          = tree.hessian[{node_id, output}];
-            auto G_R        = G - G_L;
-            auto H_R        = H - H_L;
-            double reg      = std::max(eps, alpha);  // Regularisation term
-            gain +=
-              0.5 * ((G_L * G_L) / (H_L + reg) + (G_R * G_R) / (H_R + reg) - (G * G) / (H + reg));
+            gain += CalculateSplitGain(G_L, H_L, G, H, alpha);
           }
           if (gain > best_gain) {
             best_gain    = gain;
@@ -298,7 +608,7 @@ struct TreeBuilder {
         }
         if (hessian_left[0] <= 0.0 || hessian_right[0] <= 0.0) continue;
         tree.AddSplit(node_id,
-                      best_feature,
+                      feature_offset + best_feature,
                       split_proposals.split_proposals[{best_bin}],
                       left_leaf,
                       right_leaf,
@@ -310,24 +620,142 @@ struct TreeBuilder {
       }
     }
   }
-  template <typename TYPE>
+  // With features partitioned each worker has only searched its own features
+  // The best split of each node is chosen by gain, lowest feature first on ties, and copied to
+  // every worker from the one that found it. No histograms are sent.
+  void ExchangeBestSplits(int depth, legate::TaskContext context, Tree& tree)
+  {
+    if (!feature_parallel) return;
+    auto domain      = context.get_launch_domain();
+    size_t num_ranks = domain.get_volume();
+    if (num_ranks == 1 || context.num_communicators() == 0) return;
+    auto comm_ptr = context.communicator(0).get<legate::comm::coll::CollComm>();
+    EXPECT(comm_ptr != nullptr, "CPU communicator is null.");
+    int node_begin = BinaryTree::LevelBegin(depth);
+    int num_nodes  = BinaryTree::NodesInLevel(depth);
+
+    std::vector<double> candidates(num_nodes * 2);
+    for (int k = 0; k < num_nodes; k++) {
+      candidates[k * 2]     = tree.gain[node_begin + k];
+      candidates[k * 2 + 1] = tree.feature[node_begin + k];
+    }
+    std::vector<double> all_candidates(num_nodes * 2 * num_ranks);
+    profile.Add(ProfileField::kBytesReduced, candidates.size() * sizeof(double));
+    auto result = legate::comm::coll::collAllgather(
+      candidates.data(), all_candidates.data(), num_nodes * 2, CollType<double>(), comm_ptr);
+    EXPECT(result == legate::comm::coll::CollSuccess, "CPU communicator failed.");
+
+    // Every worker but the owner contributes zeros, so a sum copies the owner's split
+    // Record layout: feature + 1, split value, gain, then value, gradient and hessian for each
+    // output of the left child followed by the right child
+    const int record_size = 3 + 6 * num_outputs;
+    std::vector<double> records(num_nodes * record_size, 0.0);
+    for (int k = 0; k < num_nodes; k++) {
+      double best_gain    = 0.0;
+      double best_feature = -1.0;
+      for (size_t r = 0; r < num_ranks; r++) {
+        double gain    = all_candidates[(r * num_nodes + k) * 2];
+        double feature = all_candidates[(r * num_nodes + k) * 2 + 1];
+        if (feature < 0) continue;
+        if (best_feature < 0 || gain > best_gain || (gain == best_gain && feature < best_feature)) {
+          best_gain    = gain;
+          best_feature = feature;
+        }
+      }
+      int node_id = node_begin + k;
+      if (best_feature < 0 || tree.feature[node_id] != best_feature) continue;
+      int children[2] = {BinaryTree::LeftChild(node_id), BinaryTree::RightChild(node_id)};
+      double* record  = records.data() + k * record_size;
+      record[0]       = tree.feature[node_id] + 1;
+      record[1]       = tree.split_value[node_id];
+      record[2]       = tree.gain[node_id];
+      for (int i = 0; i < 2 * num_outputs; i++) {
+        int child      = children[i / num_outputs];
+        int output     = i % num_outputs;
+        double* values = record + 3 * (i + 1);
+        values[0]      = tree.leaf_value[{child, output}];
+        values[1]      = tree.gradient[{child, output}];
+        values[2]      = tree.hessian[{child, output}];
+      }
+    }
+    profile.Add(ProfileField::kBytesReduced, records.size() * sizeof(double));
+    SumAllReduce(context, records.data(), records.size());
+
+    for (int k = 0; k < num_nodes; k++) {
+      int node_id               = node_begin + k;
+      int children[2]           = {BinaryTree::LeftChild(node_id), BinaryTree::RightChild(node_id)};
+      const double* record      = records.data() + k * record_size;
+      tree.feature[node_id]     = static_cast<int32_t>(record[0]) - 1;
+      tree.split_value[node_id] = record[1];
+      tree.gain[node_id]        = record[2];
+      for (int i = 0; i < 2 * num_outputs; i++) {
+        int child                        = children[i / num_outputs];
+        int output                       = i % num_outputs;
+        const double* values             = record + 3 * (i + 1);
+        tree.leaf_value[{child, output}] = values[0];
+        tree.gradient[{child, output}]   = values[1];
+        tree.hessian[{child, output}]    = values[2];
+      }
+    }
+  }
+
+  template <typename TYPE, typename Policy>
   void UpdatePositions(int depth,
+                       legate::TaskContext context,
                        Tree& tree,
                        legate::AccessorRO<TYPE, 3> X,
-                       legate::Rect<3> X_shape)
+                       legate::Rect<3> X_shape,
+                       Policy& policy)
   {
     if (depth == 0) return;
+    // With features partitioned only the worker holding a split's feature can evaluate it
+    // Workers exchange a bitmap of the rows that go left
+    std::vector<uint32_t> goes_left;
+    if (feature_parallel) {
+      goes_left.resize((num_rows + 31) / 32, 0);
+      for (int64_t i = X_shape.lo[0]; i <= X_shape.hi[0]; i++) {
+        auto index_local = i - X_shape.lo[0];
+        int pos          = positions[index_local];
+        if (pos < 0 || tree.IsLeaf(pos)) continue;
+        int feature = tree.feature[pos];
+        if (feature < feature_offset || feature >= feature_offset + num_features) continue;
+        if (X[{i, feature, 0}] <= tree.split_value[pos]) {
+          goes_left[index_local / 32] |= 1u << (index_local % 32);
+        }
+      }
+      profile.Add(ProfileField::kBytesReduced, goes_left.size() * sizeof(uint32_t));
+      OrAllReduce(context, goes_left.data(), goes_left.size());
+    }
+
     // Update the positions
-    for (int64_t i = X_shape.lo[0]; i <= X_shape.hi[0]; i++) {
-      auto index_local = i - X_shape.lo[0];
-      int& pos         = positions[index_local];
-      if (pos < 0 || tree.IsLeaf(pos)) {
-        pos = -1;
-        continue;
+    thrust::for_each_n(
+      policy, thrust::make_counting_iterator<int64_t>(0), num_rows, [&](int64_t index_local) {
+        auto i   = X_shape.lo[0] + index_local;
+        int& pos = positions[index_local];
+        // Rows stay at the leaf they reached, encoded as a negative position
+        if (pos < 0) return;
+        if (tree.IsLeaf(pos)) {
+          pos = -pos - 1;
+          return;
+        }
+        bool left = feature_parallel ? (goes_left[index_local / 32] >> (index_local % 32)) & 1u
+                                     : X[{i, tree.feature[pos], 0}] <= tree.split_value[pos];
+        pos       = left ? BinaryTree::LeftChild(pos) : BinaryTree::RightChild(pos);
+      });
+  }
+
+  // Writes the value of the leaf each local row ended up in
+  // Call after a final UpdatePositions so rows have been routed through the last level of splits
+  void WritePredictions(legate::PhysicalStore pred, const Tree& tree)
+  {
+    auto pred_shape    = pred.shape<3>();
+    auto pred_accessor = pred.write_accessor<double, 3>();
+    for (int64_t i = pred_shape.lo[0]; i <= pred_shape.hi[0]; i++) {
+      int pos  = positions[i - pred_shape.lo[0]];
+      int leaf = pos < 0 ? -pos - 1 : pos;
+      for (int j = 0; j < num_outputs; j++) {
+        pred_accessor[{i, pred_shape.lo[1], j}] = tree.leaf_value[{leaf, j}];
       }
-      auto x    = X[{i, tree.feature[pos], 0}];
-      bool left = x <= tree.split_value[pos];
-      pos       = left ? BinaryTree::LeftChild(pos) : BinaryTree::RightChild(pos);
     }
   }
 
@@ -344,7 +772,12 @@ struct TreeBuilder {
         base_sums[j] += {g_accessor[{i, 0, j}], h_accessor[{i, 0, j}]};
       }
     }
-    SumAllReduce(context, reinterpret_cast<double*>(base_sums.data()), num_outputs * 2);
+    if (!feature_parallel) {
+      profile.Add(ProfileField::kBytesReduced, base_sums.size() * sizeof(GPair));
+      profile.Time(ProfileField::kAllReduce, [&] {
+        SumAllReduce(context, reinterpret_cast<double*>(base_sums.data()), num_outputs * 2);
+      });
+    }
     for (auto i = 0; i < num_outputs; ++i) {
       auto [G, H]             = base_sums[i];
       tree.leaf_value[{0, i}] = CalculateLeafValue(G, H, alpha);
@@ -358,13 +791,21 @@ struct TreeBuilder {
   const int32_t num_features;
   const int32_t num_outputs;
   const int32_t max_nodes;
+  const int32_t histogram_chunks;
+  const HistogramExchange histogram_exchange;
+  const int32_t feature_offset;
+  const bool feature_parallel;
+  const int32_t voting_top_k;
   SparseSplitProposals<T> split_proposals;
+  TaskProfile& profile;
   legate::Buffer<GPair, 3> histogram_buffer;
+  // Per-node sums of this worker's rows, used to nominate features for voting
+  std::vector<GPair> local_node_sums;
 };
 
 struct build_tree_fn {
-  template <typename T>
-  void operator()(legate::TaskContext context)
+  template <typename T, typename Policy>
+  void operator()(legate::TaskContext context, Policy& policy)
   {
     auto [X, X_shape, X_accessor] = GetInputStore<T, 3>(context.input(0).data());
     auto [g, g_shape, g_accessor] = GetInputStore<double, 3>(context.input(1).data());
@@ -379,30 +820,80 @@ struct build_tree_fn {
     EXPECT(g_shape.lo[2] == 0, "Expect all outputs to be present");
 
     // Scalars
-    auto max_depth     = context.scalars().at(0).value<int>();
-    auto max_nodes     = context.scalars().at(1).value<int>();
-    auto alpha         = context.scalars().at(2).value<double>();
-    auto split_samples = context.scalars().at(3).value<int>();
-    auto seed          = context.scalars().at(4).value<int>();
-    auto dataset_rows  = context.scalars().at(5).value<int64_t>();
+    auto max_depth        = context.scalars().at(0).value<int>();
+    auto max_nodes        = context.scalars().at(1).value<int>();
+    auto alpha            = context.scalars().at(2).value<double>();
+    auto split_samples    = context.scalars().at(3).value<int>();
+    auto seed             = context.scalars().at(4).value<int>();
+    auto dataset_rows     = context.scalars().at(5).value<int64_t>();
+    auto histogram_chunks = context.scalars().at(6).value<int>();
+    EXPECT(histogram_chunks >= 1, "histogram_chunks must be at least 1.");
+    auto histogram_exchange =
+      static_cast<HistogramExchange>(context.scalars().at(7).value<int32_t>());
+    auto feature_parallel = context.scalars().at(BUILD_TREE_FEATURE_PARALLEL).value<bool>();
+    if (feature_parallel) {
+      EXPECT(X_shape.lo[0] == 0 && X_shape.hi[0] == dataset_rows - 1,
+             "Expected all rows on every worker when partitioning features.");
+    }
+    auto voting_top_k = context.scalars().at(9).value<int32_t>();
+    EXPECT(voting_top_k >= 0, "voting_top_k must not be negative.");
+    EXPECT(voting_top_k == 0 || !feature_parallel,
+           "Voting requires the data to be partitioned by rows.");
 
+    TaskProfile profile(context, 0);
+    profile.Add(ProfileField::kRows, num_rows);
     Tree tree(max_nodes, num_outputs);
     SparseSplitProposals<T> split_proposals =
-      SelectSplitSamples(context, X_accessor, X_shape, split_samples, seed, dataset_rows);
+      profile.Time(ProfileField::kSplitProposals, [&] {
+        return SelectSplitSamples(context,
+                                  X_accessor,
+                                  X_shape,
+                                  split_samples,
+                                  seed,
+                                  dataset_rows,
+                                  feature_parallel,
+                                  profile);
+      });
 
     // Begin building the tree
-    TreeBuilder<T> tree_builder(num_rows, num_features, num_outputs, max_nodes, split_proposals);
+    TreeBuilder<T> tree_builder(num_rows,
+                                num_features,
+                                num_outputs,
+                                max_nodes,
+                                histogram_chunks,
+                                histogram_exchange,
+                                X_shape.lo[1],
+                                feature_parallel,
+                                voting_top_k,
+                                split_proposals,
+                                profile);
 
     tree_builder.InitialiseRoot(context, tree, g_accessor, h_accessor, g_shape, alpha);
     for (int64_t depth = 0; depth < max_depth; ++depth) {
-      tree_builder.UpdatePositions(depth, tree, X_accessor, X_shape);
+      profile.Time(ProfileField::kUpdatePositions, [&] {
+        tree_builder.UpdatePositions(depth, context, tree, X_accessor, X_shape, policy);
+      });
 
-      tree_builder.ComputeHistogram(
-        depth, context, tree, X_accessor, X_shape, g_accessor, h_accessor);
-      tree_builder.PerformBestSplit(depth, tree, alpha);
+      profile.Time(ProfileField::kHistogram, [&] {
+        tree_builder.ComputeHistogram(
+          depth, context, tree, X_accessor, X_shape, g_accessor, h_accessor, policy);
+      });
+      tree_builder.ReduceScanAndSplit(depth, context, tree, alpha);
+      profile.Time(ProfileField::kAllReduce,
+                   [&] { tree_builder.ExchangeBestSplits(depth, context, tree); });
+    }
+
+    // Optionally predict the training rows from the leaves they reached, saving a PREDICT launch
+    if (context.outputs().size() > 5) {
+      EXPECT_AXIS_ALIGNED(0, X_shape, context.output(5).data().shape<3>());
+      profile.Time(ProfileField::kUpdatePositions, [&] {
+        tree_builder.UpdatePositions(max_depth, context, tree, X_accessor, X_shape, policy);
+        tree_builder.WritePredictions(context.output(5).data(), tree);
+      });
     }
 
     WriteTreeOutput(context, tree);
+    profile.Write();
   }
 };
 
@@ -411,8 +902,17 @@ struct build_tree_fn {
 /*static*/ void BuildTreeTask::cpu_variant(legate::TaskContext context)
 {
   const auto& X = context.input(0).data();
-  legateboost::type_dispatch_float(X.code(), build_tree_fn(), context);
+  legateboost::type_dispatch_float(X.code(), build_tree_fn(), context, thrust::host);
+}
+
+#ifdef LEGATEBOOST_USE_OPENMP
+/*static*/ void BuildTreeTask::omp_variant(legate::TaskContext context)
+{
+  const auto& X = context.input(0).data();
+  auto policy   = thrust::omp::par;
+  legateboost::type_dispatch_float(X.code(), build_tree_fn(), context, policy);
 }
+#endif
 
 }  // namespace legateboost
 
@@ -19,14 +19,18 @@
 #include "../../cpp_utils/cpp_utils.cuh"
 #include "core/comm/coll.h"
 #include "build_tree.h"
+#include <limits>
 #include <numeric>
 
 #include <cuda/std/tuple>
+#include <thrust/copy.h>
+#include <thrust/count.h>
 #include <thrust/execution_policy.h>
 #include <thrust/iterator/constant_iterator.h>
 #include <thrust/iterator/discard_iterator.h>
 #include <thrust/sort.h>
 #include <thrust/random.h>
+#include <thrust/transform_reduce.h>
 #include <thrust/unique.h>
 #include <cooperative_groups.h>
 namespace cg = cooperative_groups;
@@ -67,6 +71,7 @@ __global__ static void __launch_bounds__(THREADS_PER_BLOCK, MIN_CTAS_PER_SM)
                  size_t n_local_samples,
                  size_t n_features,
                  int64_t sample_offset,
+                 int32_t feature_offset,
                  legate::AccessorRO<double, 3> g,
                  legate::AccessorRO<double, 3> h,
                  size_t n_outputs,
@@ -103,7 +108,7 @@ __global__ static void __launch_bounds__(THREADS_PER_BLOCK, MIN_CTAS_PER_SM)
       for (int32_t featureIdx = 0; featureIdx < FEATURES_PER_BLOCK; featureIdx++) {
         int32_t feature = featureIdx + blockIdx.y * FEATURES_PER_BLOCK;
         if (computeHistogram && feature < n_features) {
-          auto x_value = X[{globalSampleId, feature, 0}];
+          auto x_value = X[{globalSampleId, feature_offset + feature, 0}];
           auto bin_idx = split_proposals.FindBin(x_value, feature);
 
           // bin_idx is the first sample that is larger than x_value
@@ -127,6 +132,7 @@ __global__ static void __launch_bounds__(THREADS_PER_BLOCK)
               int n_outputs,
               const SparseSplitProposals<T> split_proposals,
               int depth,
+              int parent_begin,
               int num_nodes_to_process)
 
 {
@@ -147,7 +153,7 @@ __global__ static void __launch_bounds__(THREADS_PER_BLOCK)
     scan_node_idx     = 0;
     subtract_node_idx = -1;
   } else {
-    int parent_idx    = BinaryTree::LevelBegin(depth - 1) + j;
+    int parent_idx    = parent_begin + j;
     auto [scan, sub]  = SelectHistogramNode(parent_idx, node_hessians);
     scan_node_idx     = scan;
     subtract_node_idx = sub;
@@ -224,10 +230,11 @@ __global__ static void __launch_bounds__(THREADS_PER_BLOCK, MIN_CTAS_PER_SM)
                      legate::Buffer<int32_t, 1> tree_feature,
                      legate::Buffer<double, 1> tree_split_value,
                      legate::Buffer<double, 1> tree_gain,
-                     int depth)
+                     int node_begin,
+                     int feature_offset)
 {
   // using one block per (level) node to have blockwise reductions
-  int node_id = blockIdx.x + BinaryTree::LevelBegin(depth);
+  int node_id = blockIdx.x + node_begin;
 
   typedef cub::BlockReduce<GainFeaturePair, THREADS_PER_BLOCK> BlockReduce;
   __shared__ typename BlockReduce::TempStorage temp_storage;
@@ -249,15 +256,13 @@ __global__ static void __launch_bounds__(THREADS_PER_BLOCK, MIN_CTAS_PER_SM)
         auto G          = tree_gradient[{node_id, output}];
         auto H          = tree_hessian[{node_id, output}];
         auto [G_L, H_L] = histogram[{node_id, output, bin_idx}];
-        auto G_R        = G - G_L;
         auto H_R        = H - H_L;
 
         if (H_L <= 0.0 || H_R <= 0.0) {
           gain = 0;
           break;
         }
-        double reg = std::max(eps, alpha);  // Regularisation term
-        gain += 0.5 * ((G_L * G_L) / (H_L + reg) + (G_R * G_R) / (H_R + reg) - (G * G) / (H + reg));
+        gain += CalculateSplitGain(G_L, H_L, G, H, alpha);
       }
       if (gain > thread_best_gain) {
         thread_best_gain    = gain;
@@ -294,7 +299,7 @@ __global__ static void __launch_bounds__(THREADS_PER_BLOCK, MIN_CTAS_PER_SM)
       tree_gradient[{right_child, output}]   = G_R;
 
       if (output == 0) {
-        tree_feature[node_id]     = node_best_feature;
+        tree_feature[node_id]     = feature_offset + node_best_feature;
         tree_split_value[node_id] = split_proposals.split_proposals[{node_best_bin_idx}];
         tree_gain[node_id]        = node_best_gain;
       }
@@ -392,7 +397,132 @@ struct Tree {
   cudaStream_t stream;
 };
 
+struct IsNonEmpty {
+  __device__ bool operator()(const GPair& bin) const { return bin.grad != 0.0 || bin.hess != 0.0; }
+};
+
+// Sends the non-empty bins as (index, value) pairs with values of type V, then sums every worker's
+// pairs into bins
+template <typename V, typename ThrustPolicyT>
+void SparseExchangeHistogram(ncclComm_t* nccl_comm,
+                             const std::vector<int32_t>& non_empty,
+                             int32_t local_non_empty,
+                             GPair* bins,
+                             int64_t num_bins,
+                             cudaStream_t stream,
+                             const ThrustPolicyT& policy)
+{
+  size_t num_ranks      = non_empty.size();
+  int32_t max_non_empty = *std::max_element(non_empty.begin(), non_empty.end());
+  auto send_index       = legate::create_buffer<int32_t, 1>(max_non_empty);
+  auto send_value       = legate::create_buffer<V, 1>(max_non_empty * 2);
+  auto recv_index       = legate::create_buffer<int32_t, 1>(max_non_empty * num_ranks);
+  auto recv_value       = legate::create_buffer<V, 1>(max_non_empty * 2 * num_ranks);
+  auto counting         = thrust::make_counting_iterator<int32_t>(0);
+  thrust::copy_if(policy, counting, counting + num_bins, bins, send_index.ptr(0), IsNonEmpty());
+  auto send_index_ptr = send_index.ptr(0);
+  auto send_value_ptr = send_value.ptr(0);
+  LaunchN(local_non_empty, stream, [=] __device__(auto k) {
+    auto bin                  = bins[send_index_ptr[k]];
+    send_value_ptr[k * 2]     = bin.grad;
+    send_value_ptr[k * 2 + 1] = bin.hess;
+  });
+
+  auto type = std::is_same<V, float>::value ? ncclFloat : ncclDouble;
+  CHECK_NCCL(ncclGroupStart());
+  CHECK_NCCL(ncclAllGather(
+    send_index_ptr, recv_index.ptr(0), max_non_empty, ncclInt32, *nccl_comm, stream));
+  CHECK_NCCL(ncclAllGather(
+    send_value_ptr, recv_value.ptr(0), max_non_empty * 2, type, *nccl_comm, stream));
+  CHECK_NCCL(ncclGroupEnd());
+
+  // Sum in rank order so every worker ends up with identical bins
+  CHECK_CUDA(cudaMemsetAsync(bins, 0, num_bins * sizeof(GPair), stream));
+  auto recv_index_ptr = recv_index.ptr(0);
+  auto recv_value_ptr = recv_value.ptr(0);
+  for (size_t r = 0; r < num_ranks; r++) {
+    auto offset = r * max_non_empty;
+    LaunchN(non_empty[r], stream, [=] __device__(auto k) {
+      auto idx = offset + k;
+      bins[recv_index_ptr[idx]] += GPair{recv_value_ptr[idx * 2], recv_value_ptr[idx * 2 + 1]};
+    });
+  }
+  CHECK_CUDA_STREAM(stream);
+}
+
+// Sums histogram bins over workers in the format selected by exchange
+// Blocks the host until the number of non-empty bins on every worker is known
+// Adds the bytes each worker sends in that format to the profile
+void ExchangeHistogram(legate::TaskContext context,
+                       HistogramExchange exchange,
+                       GPair* bins,
+                       int64_t num_bins,
+                       cudaStream_t stream,
+                       StreamProfile& profile)
+{
+  static_assert(sizeof(GPair) == 2 * sizeof(double), "GPair must be 2 doubles");
+  auto domain      = context.get_launch_domain();
+  size_t num_ranks = domain.get_volume();
+  if (exchange == HistogramExchange::kDense || num_ranks == 1 ||
+      context.num_communicators() == 0) {
+    profile.Add(ProfileField::kBytesReduced, num_bins * sizeof(GPair));
+    SumAllReduce(context, reinterpret_cast<double*>(bins), num_bins * 2, stream);
+    return;
+  }
+  EXPECT(num_bins <= std::numeric_limits<int32_t>::max(), "Histogram chunk too large.");
+  auto comm             = context.communicator(0);
+  ncclComm_t* nccl_comm = comm.get<ncclComm_t*>();
+  auto thrust_alloc     = ThrustAllocator(legate::Memory::GPU_FB_MEM);
+  auto policy           = DEFAULT_POLICY(thrust_alloc).on(stream);
+
+  int32_t local_non_empty = thrust::count_if(policy, bins, bins + num_bins, IsNonEmpty());
+
+  auto send_count  = legate::create_buffer<int32_t, 1>(1);
+  auto recv_counts = legate::create_buffer<int32_t, 1>(num_ranks);
+  CHECK_CUDA(cudaMemcpyAsync(
+    send_count.ptr(0), &local_non_empty, sizeof(int32_t), cudaMemcpyHostToDevice, stream));
+  CHECK_NCCL(
+    ncclAllGather(send_count.ptr(0), recv_counts.ptr(0), 1, ncclInt32, *nccl_comm, stream));
+  std::vector<int32_t> non_empty(num_ranks);
+  CHECK_CUDA(cudaMemcpyAsync(non_empty.data(),
+                             recv_counts.ptr(0),
+                             num_ranks * sizeof(int32_t),
+                             cudaMemcpyDeviceToHost,
+                             stream));
+  CHECK_CUDA(cudaStreamSynchronize(stream));
+  int32_t max_non_empty = *std::max_element(non_empty.begin(), non_empty.end());
+  profile.Add(ProfileField::kBytesReduced, sizeof(int32_t));
+
+  bool use_float32   = exchange == HistogramExchange::kFloat32;
+  size_t value_bytes = use_float32 ? sizeof(float) : sizeof(double);
+  if (UseSparseHistogram(num_bins, max_non_empty, num_ranks, value_bytes)) {
+    profile.Add(ProfileField::kBytesReduced, max_non_empty * (sizeof(int32_t) + 2 * value_bytes));
+    if (use_float32) {
+      SparseExchangeHistogram<float>(
+        nccl_comm, non_empty, local_non_empty, bins, num_bins, stream, policy);
+    } else {
+      SparseExchangeHistogram<double>(
+        nccl_comm, non_empty, local_non_empty, bins, num_bins, stream, policy);
+    }
+  } else if (use_float32) {
+    // NCCL sums float32 without compensation, in an order chosen by the library
+    profile.Add(ProfileField::kBytesReduced, num_bins * 2 * sizeof(float));
+    auto values     = legate::create_buffer<float, 1>(num_bins * 2);
+    auto values_ptr = values.ptr(0);
+    auto bins_ptr   = reinterpret_cast<double*>(bins);
+    LaunchN(num_bins * 2, stream, [=] __device__(auto i) { values_ptr[i] = bins_ptr[i]; });
+    SumAllReduce(context, values_ptr, num_bins * 2, stream);
+    LaunchN(num_bins * 2, stream, [=] __device__(auto i) { bins_ptr[i] = values_ptr[i]; });
+  } else {
+    profile.Add(ProfileField::kBytesReduced, num_bins * sizeof(GPair));
+    SumAllReduce(context, reinterpret_cast<double*>(bins), num_bins * 2, stream);
+  }
+  CHECK_CUDA_STREAM(stream);
+}
+
 // Randomly sample split_samples rows from X
+// Every worker draws the same rows from the shared seed and reads the ones it owns, so the samples
+// do not depend on how rows are partitioned
 // Use nccl to share the samples with all workers
 // Remove any duplicates
 // Return sparse matrix of split samples for each feature
@@ -403,7 +533,9 @@ SparseSplitProposals<T> SelectSplitSamples(legate::TaskContext context,
                                            int split_samples,
                                            int seed,
                                            int64_t dataset_rows,
-                                           cudaStream_t stream)
+                                           bool feature_parallel,
+                                           cudaStream_t stream,
+                                           StreamProfile& profile)
 {
   auto thrust_alloc = ThrustAllocator(legate::Memory::GPU_FB_MEM);
   auto policy       = DEFAULT_POLICY(thrust_alloc).on(stream);
@@ -418,19 +550,42 @@ SparseSplitProposals<T> SelectSplitSamples(legate::TaskContext context,
       eng.discard(idx);
       return dist(eng);
     });
-  auto draft_proposals = legate::create_buffer<T, 2>({num_features, split_samples});
-
-  // fill with local data
-  LaunchN(num_features * split_samples, stream, [=] __device__(auto idx) {
-    auto i                  = idx / num_features;
-    auto j                  = idx % num_features;
-    auto row                = row_samples[i];
-    bool has_data           = row >= X_shape.lo[0] && row <= X_shape.hi[0];
-    draft_proposals[{j, i}] = has_data ? X[{row, j, 0}] : T(0);
+  // Keep the slots of the samples in this worker's rows
+  auto slots     = legate::create_buffer<int32_t, 1>(split_samples);
+  auto slots_ptr = slots.ptr(0);
+  int64_t row_lo = X_shape.lo[0];
+  int64_t row_hi = X_shape.hi[0];
+  auto slots_end = thrust::copy_if(
+    policy, counting, counting + split_samples, slots_ptr, [=] __device__(int32_t i) {
+      return row_samples[i] >= row_lo && row_samples[i] <= row_hi;
+    });
+  int local_samples = slots_end - slots_ptr;
+  auto local_rows   = legate::create_buffer<T, 1>(local_samples * num_features);
+  LaunchN(local_samples * num_features, stream, [=] __device__(auto idx) {
+    auto i          = idx / num_features;
+    auto j          = idx % num_features;
+    local_rows[idx] = X[{row_samples[slots_ptr[i]], X_shape.lo[1] + j, 0}];
   });
 
-  // Sum reduce over all workers
-  SumAllReduce(context, draft_proposals.ptr({0, 0}), num_features * split_samples, stream);
+  // [split_samples, num_features]
+  // With features partitioned every worker already holds all rows of its own features
+  auto samples = legate::create_buffer<T, 1>(split_samples * num_features);
+  if (feature_parallel) {
+    CHECK_CUDA(cudaMemcpyAsync(samples.ptr(0),
+                               local_rows.ptr(0),
+                               local_samples * num_features * sizeof(T),
+                               cudaMemcpyDeviceToDevice,
+                               stream));
+  } else {
+    profile.Add(ProfileField::kBytesReduced, local_samples * num_features * sizeof(T));
+    AllGatherRows(context,
+                  local_rows.ptr(0),
+                  slots_ptr,
+                  local_samples,
+                  num_features,
+                  samples.ptr(0),
+                  stream);
+  }
 
   CHECK_CUDA_STREAM(stream);
 
@@ -439,12 +594,11 @@ SparseSplitProposals<T> SelectSplitSamples(legate::TaskContext context,
   auto keys = legate::create_buffer<int32_t, 1>(num_features * split_samples);
   thrust::transform(
     policy, counting, counting + num_features * split_samples, keys.ptr(0), [=] __device__(int i) {
-      return i / split_samples;
+      return i % num_features;
     });
 
   // Segmented sort
-  auto begin =
-    thrust::make_zip_iterator(thrust::make_tuple(keys.ptr(0), draft_proposals.ptr({0, 0})));
+  auto begin = thrust::make_zip_iterator(thrust::make_tuple(keys.ptr(0), samples.ptr(0)));
   thrust::sort(policy, begin, begin + num_features * split_samples, [] __device__(auto a, auto b) {
     if (thrust::get<0>(a) != thrust::get<0>(b)) { return thrust::get<0>(a) < thrust::get<0>(b); }
     return thrust::get<1>(a) < thrust::get<1>(b);
@@ -453,8 +607,7 @@ SparseSplitProposals<T> SelectSplitSamples(legate::TaskContext context,
   // Extract the unique values
   auto out_keys        = legate::create_buffer<int32_t, 1>(num_features * split_samples);
   auto split_proposals = legate::create_buffer<T, 1>(num_features * split_samples);
-  auto key_val =
-    thrust::make_zip_iterator(thrust::make_tuple(keys.ptr(0), draft_proposals.ptr({0, 0})));
+  auto key_val = thrust::make_zip_iterator(thrust::make_tuple(keys.ptr(0), samples.ptr(0)));
   auto out_iter =
     thrust::make_zip_iterator(thrust::make_tuple(out_keys.ptr(0), split_proposals.ptr(0)));
   auto result =
@@ -476,7 +629,9 @@ SparseSplitProposals<T> SelectSplitSamples(legate::TaskContext context,
 
   CHECK_CUDA(cudaStreamSynchronize(stream));
   row_samples.destroy();
-  draft_proposals.destroy();
+  slots.destroy();
+  local_rows.destroy();
+  samples.destroy();
   out_keys.destroy();
   return SparseSplitProposals<T>(split_proposals, row_pointers, num_features, n_unique);
 }
@@ -487,14 +642,33 @@ struct TreeBuilder {
               int32_t num_outputs,
               cudaStream_t stream,
               int32_t max_nodes,
-              SparseSplitProposals<T> split_proposals)
+              int32_t histogram_chunks,
+              HistogramExchange histogram_exchange,
+              int32_t feature_offset,
+              bool feature_parallel,
+              int32_t voting_top_k,
+              SparseSplitProposals<T> split_proposals,
+              StreamProfile& profile)
     : num_rows(num_rows),
       num_features(num_features),
       num_outputs(num_outputs),
       stream(stream),
       max_nodes(max_nodes),
-      split_proposals(split_proposals)
+      histogram_chunks(histogram_chunks),
+      histogram_exchange(histogram_exchange),
+      feature_offset(feature_offset),
+      feature_parallel(feature_parallel),
+      voting_top_k(voting_top_k),
+      split_proposals(split_proposals),
+      profile(profile),
+      chunk_reduced(histogram_chunks)
   {
+    // Histogram reductions go on their own stream so they can overlap with scans and split search
+    CHECK_CUDA(cudaStreamCreateWithFlags(&comm_stream, cudaStreamNonBlocking));
+    CHECK_CUDA(cudaEventCreateWithFlags(&histogram_filled, cudaEventDisableTiming));
+    for (auto& event : chunk_reduced) {
+      CHECK_CUDA(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+    }
     positions = legate::create_buffer<int32_t>(num_rows);
     histogram_buffer =
       legate::create_buffer<GPair, 3>({max_nodes, num_outputs, split_proposals.histogram_size});
@@ -503,6 +677,9 @@ struct TreeBuilder {
                       0,
                       max_nodes * num_outputs * split_proposals.histogram_size * sizeof(GPair),
                       stream));
+    local_node_sums = legate::create_buffer<GPair, 2>({max_nodes, num_outputs});
+    CHECK_CUDA(cudaMemsetAsync(
+      local_node_sums.ptr({0, 0}), 0, max_nodes * num_outputs * sizeof(GPair), stream));
     // some initialization on first pass
     CHECK_CUDA(cudaMemsetAsync(positions.ptr(0), 0, (size_t)num_rows * sizeof(int32_t), stream));
   }
@@ -511,24 +688,65 @@ struct TreeBuilder {
   {
     positions.destroy();
     histogram_buffer.destroy();
+    local_node_sums.destroy();
     if (cub_buffer_size > 0) cub_buffer.destroy();
+    for (auto& event : chunk_reduced) { CHECK_CUDA(cudaEventDestroy(event)); }
+    CHECK_CUDA(cudaEventDestroy(histogram_filled));
+    CHECK_CUDA(cudaStreamDestroy(comm_stream));
   }
 
   template <typename TYPE>
   void UpdatePositions(int depth,
+                       legate::TaskContext context,
                        Tree& tree,
                        legate::AccessorRO<TYPE, 3> X,
                        legate::Rect<3> X_shape)
   {
     if (depth == 0) return;
-    auto tree_split_value_ptr    = tree.split_value.ptr(0);
-    auto tree_feature_ptr        = tree.feature.ptr(0);
-    auto positions_ptr           = positions.ptr(0);
-    auto max_nodes_              = this->max_nodes;
+    auto tree_split_value_ptr = tree.split_value.ptr(0);
+    auto tree_feature_ptr     = tree.feature.ptr(0);
+    auto positions_ptr        = positions.ptr(0);
+    auto max_nodes_           = this->max_nodes;
+    if (feature_parallel) {
+      // Only the worker holding a split's feature can evaluate it
+      // Workers exchange a bitmap of the rows that go left
+      auto num_words     = (num_rows + 31) / 32;
+      auto goes_left     = legate::create_buffer<uint32_t, 1>(num_words);
+      auto goes_left_ptr = goes_left.ptr(0);
+      auto feature_begin = feature_offset;
+      auto feature_end   = feature_offset + num_features;
+      CHECK_CUDA(cudaMemsetAsync(goes_left_ptr, 0, num_words * sizeof(uint32_t), stream));
+      profile.Add(ProfileField::kBytesReduced, num_words * sizeof(uint32_t));
+      LaunchN(num_rows, stream, [=] __device__(size_t idx) {
+        int32_t pos = positions_ptr[idx];
+        if (pos < 0 || pos >= max_nodes_) return;
+        int32_t feature = tree_feature_ptr[pos];
+        if (feature < feature_begin || feature >= feature_end) return;
+        double x_value = X[{X_shape.lo[0] + (int64_t)idx, feature, 0}];
+        if (x_value <= tree_split_value_ptr[pos]) {
+          atomicOr(&goes_left_ptr[idx / 32], 1u << (idx % 32));
+        }
+      });
+      OrAllReduce(context, goes_left_ptr, num_words, stream);
+      LaunchN(num_rows, stream, [=] __device__(size_t idx) {
+        int32_t& pos = positions_ptr[idx];
+        if (pos < 0) return;
+        if (pos >= max_nodes_ || tree_feature_ptr[pos] == -1) {
+          pos = -pos - 1;
+          return;
+        }
+        bool left = (goes_left_ptr[idx / 32] >> (idx % 32)) & 1u;
+        pos       = left ? BinaryTree::LeftChild(pos) : BinaryTree::RightChild(pos);
+      });
+      CHECK_CUDA_STREAM(stream);
+      return;
+    }
     auto update_positions_lambda = [=] __device__(size_t idx) {
       int32_t& pos = positions_ptr[idx];
-      if (pos < 0 || pos >= max_nodes_ || tree_feature_ptr[pos] == -1) {
-        pos = -1;
+      // Rows stay at the leaf they reached, encoded as a negative position
+      if (pos < 0) return;
+      if (pos >= max_nodes_ || tree_feature_ptr[pos] == -1) {
+        pos = -pos - 1;
         return;
       }
       double x_value = X[{X_shape.lo[0] + (int64_t)idx, tree_feature_ptr[pos], 0}];
@@ -539,6 +757,96 @@ struct TreeBuilder {
     CHECK_CUDA_STREAM(stream);
   }
 
+  // With features partitioned each worker has only searched its own features
+  // The best split of each node is chosen by gain, lowest feature first on ties, and copied to
+  // every worker from the one that found it. No histograms are sent.
+  void ExchangeBestSplits(int depth, legate::TaskContext context, Tree& tree)
+  {
+    if (!feature_parallel) return;
+    auto domain      = context.get_launch_domain();
+    size_t num_ranks = domain.get_volume();
+    if (num_ranks == 1 || context.num_communicators() == 0) return;
+    auto comm             = context.communicator(0);
+    ncclComm_t* nccl_comm = comm.get<ncclComm_t*>();
+    int node_begin        = BinaryTree::LevelBegin(depth);
+    int num_nodes         = BinaryTree::NodesInLevel(depth);
+    int n_outputs         = num_outputs;
+
+    auto candidates         = legate::create_buffer<double, 1>(num_nodes * 2);
+    auto all_candidates     = legate::create_buffer<double, 1>(num_nodes * 2 * num_ranks);
+    auto candidates_ptr     = candidates.ptr(0);
+    auto all_candidates_ptr = all_candidates.ptr(0);
+    auto feature            = tree.feature;
+    auto split_value        = tree.split_value;
+    auto gain               = tree.gain;
+    auto leaf_value         = tree.leaf_value;
+    auto gradient           = tree.gradient;
+    auto hessian            = tree.hessian;
+    LaunchN(num_nodes, stream, [=] __device__(int k) {
+      candidates_ptr[k * 2]     = gain[node_begin + k];
+      candidates_ptr[k * 2 + 1] = feature[node_begin + k];
+    });
+    profile.Add(ProfileField::kBytesReduced, num_nodes * 2 * sizeof(double));
+    CHECK_NCCL(ncclAllGather(
+      candidates_ptr, all_candidates_ptr, num_nodes * 2, ncclDouble, *nccl_comm, stream));
+
+    // Every worker but the owner contributes zeros, so a sum copies the owner's split
+    // Record layout: feature + 1, split value, gain, then value, gradient and hessian for each
+    // output of the left child followed by the right child
+    const int record_size = 3 + 6 * num_outputs;
+    auto records          = legate::create_buffer<double, 1>(num_nodes * record_size);
+    auto records_ptr      = records.ptr(0);
+    CHECK_CUDA(cudaMemsetAsync(records_ptr, 0, num_nodes * record_size * sizeof(double), stream));
+    LaunchN(num_nodes, stream, [=] __device__(int k) {
+      double best_gain    = 0.0;
+      double best_feature = -1.0;
+      for (size_t r = 0; r < num_ranks; r++) {
+        double g = all_candidates_ptr[(r * num_nodes + k) * 2];
+        double f = all_candidates_ptr[(r * num_nodes + k) * 2 + 1];
+        if (f < 0) continue;
+        if (best_feature < 0 || g > best_gain || (g == best_gain && f < best_feature)) {
+          best_gain    = g;
+          best_feature = f;
+        }
+      }
+      int node_id = node_begin + k;
+      if (best_feature < 0 || feature[node_id] != best_feature) return;
+      int children[2] = {BinaryTree::LeftChild(node_id), BinaryTree::RightChild(node_id)};
+      double* record  = records_ptr + k * record_size;
+      record[0]       = feature[node_id] + 1;
+      record[1]       = split_value[node_id];
+      record[2]       = gain[node_id];
+      for (int i = 0; i < 2 * n_outputs; i++) {
+        int child      = children[i / n_outputs];
+        int output     = i % n_outputs;
+        double* values = record + 3 * (i + 1);
+        values[0]      = leaf_value[{child, output}];
+        values[1]      = gradient[{child, output}];
+        values[2]      = hessian[{child, output}];
+      }
+    });
+    profile.Add(ProfileField::kBytesReduced, num_nodes * record_size * sizeof(double));
+    SumAllReduce(context, records_ptr, num_nodes * record_size, stream);
+
+    LaunchN(num_nodes, stream, [=] __device__(int k) {
+      int node_id          = node_begin + k;
+      int children[2]      = {BinaryTree::LeftChild(node_id), BinaryTree::RightChild(node_id)};
+      const double* record = records_ptr + k * record_size;
+      feature[node_id]     = static_cast<int32_t>(record[0]) - 1;
+      split_value[node_id] = record[1];
+      gain[node_id]        = record[2];
+      for (int i = 0; i < 2 * n_outputs; i++) {
+        int child                   = children[i / n_outputs];
+        int output                  = i % n_outputs;
+        const double* values        = record + 3 * (i + 1);
+        leaf_value[{child, output}] = values[0];
+        gradient[{child, output}]   = values[1];
+        hessian[{child, output}]    = values[2];
+      }
+    });
+    CHECK_CUDA_STREAM(stream);
+  }
+
   template <typename TYPE>
   void ComputeHistogram(int depth,
                         legate::TaskContext context,
@@ -560,6 +868,7 @@ struct TreeBuilder {
                                                      num_rows,
                                                      num_features,
                                                      X_shape.lo[0],
+                                                     feature_offset,
                                                      g,
                                                      h,
                                                      num_outputs,
@@ -569,33 +878,265 @@ struct TreeBuilder {
                                                      tree.hessian,
                                                      depth);
     CHECK_CUDA_STREAM(stream);
-    static_assert(sizeof(GPair) == 2 * sizeof(double), "GPair must be 2 doubles");
-    SumAllReduce(
-      context,
-      reinterpret_cast<double*>(histogram_buffer.ptr({BinaryTree::LevelBegin(depth), 0, 0})),
-      BinaryTree::NodesInLevel(depth) * num_outputs * split_proposals.histogram_size * 2,
-      stream);
-
-    const int num_nodes_to_process = std::max(BinaryTree::NodesInLevel(depth) / 2, 1);
+
+    if (UseVoting(context)) {
+      auto positions_ptr   = positions.ptr(0);
+      auto local_node_sums = this->local_node_sums;
+      auto n_outputs       = num_outputs;
+      LaunchN(num_rows * num_outputs, stream, [=] __device__(size_t idx) {
+        int64_t row = idx / n_outputs;
+        int output  = idx % n_outputs;
+        int32_t pos = positions_ptr[row];
+        if (pos < 0) return;
+        double* sum = reinterpret_cast<double*>(&local_node_sums[{pos, output}]);
+        atomicAdd(sum, g[{X_shape.lo[0] + row, 0, output}]);
+        atomicAdd(sum + 1, h[{X_shape.lo[0] + row, 0, output}]);
+      });
+      CHECK_CUDA_STREAM(stream);
+    }
+  }
+
+  // Sums the level histogram over workers in chunks of nodes
+  // Reductions are queued in order on comm_stream. The scan and split search of each chunk waits
+  // only for its own reduction, so it runs while the following chunk is still in flight. The next
+  // reduction is queued before each chunk is processed because choosing its format blocks the host.
+  void ReduceScanAndSplit(int depth, legate::TaskContext context, Tree& tree, double alpha)
+  {
+    if (UseVoting(context)) {
+      this->VotingScanAndSplit(depth, context, tree, alpha);
+      return;
+    }
+    LevelChunks chunks(depth, histogram_chunks);
+    if (feature_parallel) {
+      // Histograms are already complete, nothing to send
+      for (int chunk = 0; chunk < chunks.Count(); chunk++) {
+        auto [node_begin, node_end] = chunks.Nodes(chunk);
+        this->ScanAndSplit(depth, node_begin, node_end, tree, alpha);
+      }
+      return;
+    }
+    CHECK_CUDA(cudaEventRecord(histogram_filled, stream));
+    CHECK_CUDA(cudaStreamWaitEvent(comm_stream, histogram_filled, 0));
+    auto reduce_chunk = [&](int chunk) {
+      auto [node_begin, node_end] = chunks.Nodes(chunk);
+      auto num_bins = (node_end - node_begin) * num_outputs * split_proposals.histogram_size;
+      profile.Time(ProfileField::kAllReduce, comm_stream, [&] {
+        ExchangeHistogram(context,
+                          histogram_exchange,
+                          histogram_buffer.ptr({node_begin, 0, 0}),
+                          num_bins,
+                          comm_stream,
+                          profile);
+      });
+      CHECK_CUDA(cudaEventRecord(chunk_reduced[chunk], comm_stream));
+    };
+
+    reduce_chunk(0);
+    for (int chunk = 0; chunk < chunks.Count(); chunk++) {
+      if (chunk + 1 < chunks.Count()) { reduce_chunk(chunk + 1); }
+      auto [node_begin, node_end] = chunks.Nodes(chunk);
+      CHECK_CUDA(cudaStreamWaitEvent(stream, chunk_reduced[chunk], 0));
+      this->ScanAndSplit(depth, node_begin, node_end, tree, alpha);
+    }
+  }
+
+  void ScanAndSplit(int depth, int node_begin, int node_end, Tree& tree, double alpha)
+  {
+    profile.Time(
+      ProfileField::kScan, stream, [&] { this->Scan(depth, node_begin, node_end, tree); });
+    profile.Time(ProfileField::kSplitEvaluation,
+                 stream,
+                 [&] { this->PerformBestSplit(node_begin, node_end, tree, alpha); });
+    profile.Add(ProfileField::kBins,
+                (node_end - node_begin) * num_outputs * split_proposals.histogram_size);
+  }
+
+  // Voting is only worth it when fewer features are reduced than there are
+  bool UseVoting(legate::TaskContext context) const
+  {
+    return voting_top_k > 0 && 2 * voting_top_k < num_features &&
+           context.get_launch_domain().get_volume() > 1 && context.num_communicators() > 0;
+  }
+
+  // Writes the voting_top_k features with the highest gain on this worker's histogram, for each
+  // node of a level, to votes_ptr, padded with -1
+  void NominateFeatures(int node_begin, int num_nodes, double alpha, int32_t* votes_ptr)
+  {
+    auto thrust_alloc    = ThrustAllocator(legate::Memory::GPU_FB_MEM);
+    auto policy          = DEFAULT_POLICY(thrust_alloc).on(stream);
+    auto histogram       = histogram_buffer;
+    auto local_node_sums = this->local_node_sums;
+    auto split_proposals = this->split_proposals;
+    int n_features       = num_features;
+    int n_outputs        = num_outputs;
+    int top_k            = voting_top_k;
+
+    // Rank the features of each node by their best gain on the local histogram
+    auto nodes        = legate::create_buffer<int32_t, 1>(num_nodes * num_features);
+    auto gains        = legate::create_buffer<double, 1>(num_nodes * num_features);
+    auto features     = legate::create_buffer<int32_t, 1>(num_nodes * num_features);
+    auto nodes_ptr    = nodes.ptr(0);
+    auto gains_ptr    = gains.ptr(0);
+    auto features_ptr = features.ptr(0);
+    LaunchN(num_nodes * num_features, stream, [=] __device__(size_t idx) {
+      int k                             = idx / n_features;
+      int feature                       = idx % n_features;
+      auto [feature_begin, feature_end] = split_proposals.FeatureRange(feature);
+      double best_gain                  = 0.0;
+      for (int bin_idx = feature_begin; bin_idx < feature_end; bin_idx++) {
+        double gain = 0.0;
+        for (int output = 0; output < n_outputs; output++) {
+          auto [G_L, H_L] = histogram[{node_begin + k, output, bin_idx}];
+          auto [G, H]     = local_node_sums[{node_begin + k, output}];
+          gain += CalculateSplitGain(G_L, H_L, G, H, alpha);
+        }
+        best_gain = max(best_gain, gain);
+      }
+      nodes_ptr[idx]    = k;
+      gains_ptr[idx]    = best_gain;
+      features_ptr[idx] = feature;
+    });
+    auto ranked = thrust::make_zip_iterator(thrust::make_tuple(nodes_ptr, gains_ptr, features_ptr));
+    thrust::sort(policy, ranked, ranked + num_nodes * num_features, [] __device__(auto a, auto b) {
+      if (thrust::get<0>(a) != thrust::get<0>(b)) { return thrust::get<0>(a) < thrust::get<0>(b); }
+      if (thrust::get<1>(a) != thrust::get<1>(b)) { return thrust::get<1>(a) > thrust::get<1>(b); }
+      return thrust::get<2>(a) < thrust::get<2>(b);
+    });
+    LaunchN(num_nodes * top_k, stream, [=] __device__(size_t idx) {
+      auto ranked_idx = (idx / top_k) * n_features + idx % top_k;
+      votes_ptr[idx]  = gains_ptr[ranked_idx] > 0.0 ? features_ptr[ranked_idx] : -1;
+    });
+  }
+
+  // Voting parallel split search for row partitioned data with many features
+  // Each worker nominates the voting_top_k features of each node with the highest gain on its local
+  // histogram. Only the histograms of the 2 * voting_top_k features with the most votes are summed
+  // over workers, so the bytes sent per level do not depend on the number of features.
+  void VotingScanAndSplit(int depth, legate::TaskContext context, Tree& tree, double alpha)
+  {
+    int node_begin = BinaryTree::LevelBegin(depth);
+    int num_nodes  = BinaryTree::NodesInLevel(depth);
+    profile.Time(ProfileField::kScan,
+                 stream,
+                 [&] { this->Scan(depth, node_begin, node_begin + num_nodes, tree); });
+
+    auto thrust_alloc    = ThrustAllocator(legate::Memory::GPU_FB_MEM);
+    auto policy          = DEFAULT_POLICY(thrust_alloc).on(stream);
+    auto histogram       = histogram_buffer;
+    auto split_proposals = this->split_proposals;
+    int n_outputs        = num_outputs;
+    int top_k            = voting_top_k;
+
+    auto votes     = legate::create_buffer<int32_t, 1>(num_nodes * top_k);
+    auto votes_ptr = votes.ptr(0);
+    profile.Time(ProfileField::kSplitEvaluation,
+                 stream,
+                 [&] { this->NominateFeatures(node_begin, num_nodes, alpha, votes_ptr); });
+
+    size_t num_ranks      = context.get_launch_domain().get_volume();
+    auto comm             = context.communicator(0);
+    ncclComm_t* nccl_comm = comm.get<ncclComm_t*>();
+    auto all_votes        = legate::create_buffer<int32_t, 1>(num_nodes * top_k * num_ranks);
+    profile.Add(ProfileField::kBytesReduced, num_nodes * top_k * sizeof(int32_t));
+    profile.Time(ProfileField::kAllReduce, stream, [&] {
+      CHECK_NCCL(ncclAllGather(
+        votes_ptr, all_votes.ptr(0), num_nodes * top_k, ncclInt32, *nccl_comm, stream));
+    });
+    std::vector<int32_t> host_votes(num_nodes * top_k * num_ranks);
+    CHECK_CUDA(cudaMemcpyAsync(host_votes.data(),
+                               all_votes.ptr(0),
+                               host_votes.size() * sizeof(int32_t),
+                               cudaMemcpyDeviceToHost,
+                               stream));
+    CHECK_CUDA(cudaStreamSynchronize(stream));
+    auto host_selected = SelectVotedFeatures(host_votes, num_ranks, num_nodes, top_k);
+    int num_selected   = 2 * top_k;
+    auto selected      = legate::create_buffer<int32_t, 1>(host_selected.size());
+    auto selected_ptr  = selected.ptr(0);
+    CHECK_CUDA(cudaMemcpyAsync(selected_ptr,
+                               host_selected.data(),
+                               host_selected.size() * sizeof(int32_t),
+                               cudaMemcpyHostToDevice,
+                               stream));
+
+    // Pack the selected features of each node, each padded to the largest number of bins
+    auto row_pointers = split_proposals.row_pointers;
+    auto counting     = thrust::make_counting_iterator(0);
+    int max_bins      = thrust::transform_reduce(
+      policy,
+      counting,
+      counting + num_features,
+      [=] __device__(int feature) { return row_pointers[feature + 1] - row_pointers[feature]; },
+      0,
+      thrust::maximum<int>());
+    size_t packed_size = size_t(num_nodes) * num_selected * num_outputs * max_bins;
+    auto packed        = legate::create_buffer<GPair, 1>(packed_size);
+    auto packed_ptr    = packed.ptr(0);
+    // Maps a packed index to its histogram bin, or returns false for padding
+    auto histogram_bin = [=] __device__(size_t idx, legate::Point<3>& bin) {
+      int bin_offset = idx % max_bins;
+      int output     = (idx / max_bins) % n_outputs;
+      int slot       = idx / (max_bins * n_outputs);
+      int feature    = selected_ptr[slot];
+      if (feature < 0) return false;
+      auto [feature_begin, feature_end] = split_proposals.FeatureRange(feature);
+      if (feature_begin + bin_offset >= feature_end) return false;
+      bin = legate::Point<3>(node_begin + slot / num_selected, output, feature_begin + bin_offset);
+      return true;
+    };
+    LaunchN(packed_size, stream, [=] __device__(size_t idx) {
+      legate::Point<3> bin;
+      packed_ptr[idx] = histogram_bin(idx, bin) ? histogram[bin] : GPair{0.0, 0.0};
+    });
+    profile.Add(ProfileField::kBytesReduced, packed_size * sizeof(GPair));
+    profile.Time(ProfileField::kAllReduce, stream, [&] {
+      SumAllReduce(context, reinterpret_cast<double*>(packed_ptr), packed_size * 2, stream);
+    });
+
+    // Search the summed bins only. Bins of other features are zeroed, which gives them no gain.
+    // The local histograms are restored afterwards because the next level subtracts from them.
+    auto level      = histogram_buffer.ptr({node_begin, 0, 0});
+    auto level_size = size_t(num_nodes) * num_outputs * split_proposals.histogram_size;
+    auto local      = legate::create_buffer<GPair, 1>(level_size);
+    CHECK_CUDA(cudaMemcpyAsync(
+      local.ptr(0), level, level_size * sizeof(GPair), cudaMemcpyDeviceToDevice, stream));
+    CHECK_CUDA(cudaMemsetAsync(level, 0, level_size * sizeof(GPair), stream));
+    LaunchN(packed_size, stream, [=] __device__(size_t idx) {
+      legate::Point<3> bin;
+      if (histogram_bin(idx, bin)) { histogram[bin] = packed_ptr[idx]; }
+    });
+    profile.Time(ProfileField::kSplitEvaluation, stream, [&] {
+      this->PerformBestSplit(node_begin, node_begin + num_nodes, tree, alpha);
+    });
+    profile.Add(ProfileField::kBins, level_size);
+    CHECK_CUDA(cudaMemcpyAsync(
+      level, local.ptr(0), level_size * sizeof(GPair), cudaMemcpyDeviceToDevice, stream));
+    CHECK_CUDA_STREAM(stream);
+  }
+
+  // Scans the histograms of nodes [node_begin, node_end) in the given level
+  // Then does the subtraction trick to infer the sibling from the parent
+  void Scan(int depth, int node_begin, int node_end, Tree& tree)
+  {
+    const int num_nodes_to_process = std::max((node_end - node_begin) / 2, 1);
     const size_t warps_needed      = num_features * num_nodes_to_process;
     const size_t warps_per_block   = THREADS_PER_BLOCK / 32;
     const size_t blocks_needed     = (warps_needed + warps_per_block - 1) / warps_per_block;
 
-    // Scan the histogram
-    // Then do subtraction trick to infer right side from parent and left side
     scan_kernel<<<blocks_needed, THREADS_PER_BLOCK, 0, stream>>>(histogram_buffer,
                                                                  tree.hessian,
                                                                  num_features,
                                                                  num_outputs,
                                                                  split_proposals,
                                                                  depth,
+                                                                 BinaryTree::Parent(node_begin),
                                                                  num_nodes_to_process);
     CHECK_CUDA_STREAM(stream);
   }
 
-  void PerformBestSplit(int depth, Tree& tree, double alpha)
+  void PerformBestSplit(int node_begin, int node_end, Tree& tree, double alpha)
   {
-    perform_best_split<<<BinaryTree::NodesInLevel(depth), THREADS_PER_BLOCK, 0, stream>>>(
+    perform_best_split<<<node_end - node_begin, THREADS_PER_BLOCK, 0, stream>>>(
       histogram_buffer,
       num_features,
       num_outputs,
@@ -608,9 +1149,30 @@ struct TreeBuilder {
       tree.feature,
       tree.split_value,
       tree.gain,
-      depth);
+      node_begin,
+      feature_offset);
+    CHECK_CUDA_STREAM(stream);
+  }
+  // Writes the value of the leaf each local row ended up in
+  // Call after a final UpdatePositions so rows have been routed through the last level of splits
+  void WritePredictions(legate::PhysicalStore pred, Tree& tree)
+  {
+    auto pred_shape    = pred.shape<3>();
+    auto pred_accessor = pred.write_accessor<double, 3>();
+    auto positions_ptr = positions.ptr(0);
+    auto leaf_value    = tree.leaf_value;
+    auto n_outputs     = num_outputs;
+    LaunchN(num_rows * num_outputs, stream, [=] __device__(size_t idx) {
+      int64_t row = idx / n_outputs;
+      int output  = idx % n_outputs;
+      int32_t pos = positions_ptr[row];
+      int leaf    = pos < 0 ? -pos - 1 : pos;
+      pred_accessor[{pred_shape.lo[0] + row, pred_shape.lo[1], output}] =
+        leaf_value[{leaf, output}];
+    });
     CHECK_CUDA_STREAM(stream);
   }
+
   void InitialiseRoot(legate::TaskContext context,
                       Tree& tree,
                       legate::AccessorRO<double, 3> g,
@@ -627,7 +1189,13 @@ struct TreeBuilder {
       g, h, num_rows, g_shape.lo[0], base_sums, num_outputs);
     CHECK_CUDA_STREAM(stream);
 
-    SumAllReduce(context, reinterpret_cast<double*>(base_sums.ptr(0)), num_outputs * 2, stream);
+    if (!feature_parallel) {
+      profile.Add(ProfileField::kBytesReduced, num_outputs * 2 * sizeof(double));
+      profile.Time(ProfileField::kAllReduce, stream, [&] {
+        SumAllReduce(
+          context, reinterpret_cast<double*>(base_sums.ptr(0)), num_outputs * 2, stream);
+      });
+    }
 
     // base sums contain g-sums first, h sums second
     tree.InitializeBase(base_sums, alpha);
@@ -641,14 +1209,25 @@ struct TreeBuilder {
   const int32_t num_features;
   const int32_t num_outputs;
   const int32_t max_nodes;
+  const int32_t histogram_chunks;
+  const HistogramExchange histogram_exchange;
+  const int32_t feature_offset;
+  const bool feature_parallel;
+  const int32_t voting_top_k;
   SparseSplitProposals<T> split_proposals;
+  StreamProfile& profile;
 
   legate::Buffer<unsigned char> cub_buffer;
   size_t cub_buffer_size = 0;
 
   legate::Buffer<GPair, 3> histogram_buffer;
+  // Per-node sums of this worker's rows, used to nominate features for voting
+  legate::Buffer<GPair, 2> local_node_sums;
 
   cudaStream_t stream;
+  cudaStream_t comm_stream;
+  cudaEvent_t histogram_filled;
+  std::vector<cudaEvent_t> chunk_reduced;
 };
 
 struct build_tree_fn {
@@ -669,39 +1248,96 @@ struct build_tree_fn {
     EXPECT_AXIS_ALIGNED(1, g_shape, h_shape);
 
     // Scalars
-    auto max_depth     = context.scalars().at(0).value<int>();
-    auto max_nodes     = context.scalars().at(1).value<int>();
-    auto alpha         = context.scalars().at(2).value<double>();
-    auto split_samples = context.scalars().at(3).value<int>();
-    auto seed          = context.scalars().at(4).value<int>();
-    auto dataset_rows  = context.scalars().at(5).value<int64_t>();
+    auto max_depth        = context.scalars().at(0).value<int>();
+    auto max_nodes        = context.scalars().at(1).value<int>();
+    auto alpha            = context.scalars().at(2).value<double>();
+    auto split_samples    = context.scalars().at(3).value<int>();
+    auto seed             = context.scalars().at(4).value<int>();
+    auto dataset_rows     = context.scalars().at(5).value<int64_t>();
+    auto histogram_chunks = context.scalars().at(6).value<int>();
+    EXPECT(histogram_chunks >= 1, "histogram_chunks must be at least 1.");
+    auto histogram_exchange =
+      static_cast<HistogramExchange>(context.scalars().at(7).value<int32_t>());
+    auto feature_parallel = context.scalars().at(BUILD_TREE_FEATURE_PARALLEL).value<bool>();
+    if (feature_parallel) {
+      EXPECT(X_shape.lo[0] == 0 && X_shape.hi[0] == dataset_rows - 1,
+             "Expected all rows on every worker when partitioning features.");
+    }
+    auto voting_top_k = context.scalars().at(9).value<int32_t>();
+    EXPECT(voting_top_k >= 0, "voting_top_k must not be negative.");
+    EXPECT(voting_top_k == 0 || !feature_parallel,
+           "Voting requires the data to be partitioned by rows.");
 
     auto stream             = legate::cuda::StreamPool::get_stream_pool().get_stream();
     auto thrust_alloc       = ThrustAllocator(legate::Memory::GPU_FB_MEM);
     auto thrust_exec_policy = DEFAULT_POLICY(thrust_alloc).on(stream);
 
+    TaskProfile task_profile(context, 0);
+    StreamProfile profile(task_profile);
+    profile.Add(ProfileField::kRows, num_rows);
+
     Tree tree(max_nodes, num_outputs, stream, thrust_exec_policy);
 
     SparseSplitProposals<T> split_proposals =
-      SelectSplitSamples(context, X_accessor, X_shape, split_samples, seed, dataset_rows, stream);
+      profile.Time(ProfileField::kSplitProposals, stream, [&] {
+        return SelectSplitSamples(context,
+                                  X_accessor,
+                                  X_shape,
+                                  split_samples,
+                                  seed,
+                                  dataset_rows,
+                                  feature_parallel,
+                                  stream,
+                                  profile);
+      });
     // Begin building the tree
-    TreeBuilder<T> builder(
-      num_rows, num_features, num_outputs, stream, tree.max_nodes, split_proposals);
+    TreeBuilder<T> builder(num_rows,
+                           num_features,
+                           num_outputs,
+                           stream,
+                           tree.max_nodes,
+                           histogram_chunks,
+                           histogram_exchange,
+                           X_shape.lo[1],
+                           feature_parallel,
+                           voting_top_k,
+                           split_proposals,
+                           profile);
 
     builder.InitialiseRoot(context, tree, g_accessor, h_accessor, g_shape, alpha);
 
     for (int depth = 0; depth < max_depth; ++depth) {
       // update positions from previous step
-      builder.UpdatePositions(depth, tree, X_accessor, X_shape);
+      profile.Time(ProfileField::kUpdatePositions, stream, [&] {
+        builder.UpdatePositions(depth, context, tree, X_accessor, X_shape);
+      });
 
       // actual histogram creation
-      builder.ComputeHistogram(depth, context, tree, X_accessor, X_shape, g_accessor, h_accessor);
+      profile.Time(ProfileField::kHistogram, stream, [&] {
+        builder.ComputeHistogram(
+          depth, context, tree, X_accessor, X_shape, g_accessor, h_accessor);
+      });
+
+      // Reduce, scan and select the best split chunk by chunk
+      builder.ReduceScanAndSplit(depth, context, tree, alpha);
+
+      // With features partitioned, agree on the best split over all workers
+      profile.Time(ProfileField::kAllReduce,
+                   stream,
+                   [&] { builder.ExchangeBestSplits(depth, context, tree); });
+    }
 
-      // Select the best split
-      builder.PerformBestSplit(depth, tree, alpha);
+    // Optionally predict the training rows from the leaves they reached, saving a PREDICT launch
+    if (context.outputs().size() > 5) {
+      EXPECT_AXIS_ALIGNED(0, X_shape, context.output(5).data().shape<3>());
+      profile.Time(ProfileField::kUpdatePositions, stream, [&] {
+        builder.UpdatePositions(max_depth, context, tree, X_accessor, X_shape);
+        builder.WritePredictions(context.output(5).data(), tree);
+      });
     }
 
     tree.WriteTreeOutput(context, thrust_exec_policy);
+    profile.Write(stream);
 
     CHECK_CUDA(cudaStreamSynchronize(stream));
     CHECK_CUDA_STREAM(stream);
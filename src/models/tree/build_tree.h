@@ -16,6 +16,9 @@
 #pragma once
 #include "legate_library.h"
 #include "legateboost.h"
+#include <algorithm>
+#include <map>
+#include <vector>
 #ifdef __CUDACC__
 #include <thrust/binary_search.h>
 #endif
@@ -34,6 +37,53 @@ class BinaryTree {
   __host__ __device__ static int NodesInLevel(int level) { return 1 << level; }
 };
 
+// Divides the nodes of a level into contiguous chunks of sibling pairs
+// Each chunk of the histogram can be reduced, scanned and searched for splits on its own
+class LevelChunks {
+ public:
+  LevelChunks(int depth, int max_chunks)
+    : depth(depth), num_parents(depth == 0 ? 1 : BinaryTree::NodesInLevel(depth - 1))
+  {
+    count = std::max(1, std::min(max_chunks, num_parents));
+  }
+  int Count() const { return count; }
+  // Returns the [begin, end) node range of a chunk
+  std::pair<int, int> Nodes(int chunk) const
+  {
+    if (depth == 0) return {0, 1};
+    int first_parent = BinaryTree::LevelBegin(depth - 1);
+    int begin        = first_parent + chunk * num_parents / count;
+    int end          = first_parent + (chunk + 1) * num_parents / count;
+    return {BinaryTree::LeftChild(begin), BinaryTree::LeftChild(end)};
+  }
+
+ private:
+  int depth;
+  int num_parents;
+  int count;
+};
+
+// How histograms are sent when summing them over workers
+// Must match _HISTOGRAM_EXCHANGE in tree.py
+enum class HistogramExchange : int {
+  kDense   = 0,  // float64 allreduce of every bin
+  kAuto    = 1,  // float64, dense or sparse (index, value) pairs of non-empty bins
+  kFloat32 = 2,  // as kAuto but values are sent as float32
+};
+
+// Sparse pairs are chosen over a dense allreduce when they are expected to move fewer bytes
+// A dense allreduce moves each bin about twice, the sparse allgather receives the non-empty bins of
+// every worker once, padded to the largest count
+inline bool UseSparseHistogram(int64_t num_bins,
+                               int64_t max_non_empty,
+                               size_t num_ranks,
+                               size_t value_bytes)
+{
+  double dense_bytes  = 2.0 * num_bins * 2 * value_bytes;
+  double sparse_bytes = double(num_ranks) * max_non_empty * (sizeof(int32_t) + 2 * value_bytes);
+  return sparse_bytes < dense_bytes;
+}
+
 // Estimate if the left or right child has less data
 // We compute the histogram for the child with less data
 // And infer the other side by subtraction from the parent
@@ -64,6 +114,45 @@ __host__ __device__ inline double CalculateLeafValue(double G, double H, double
   return -G / (H + alpha);
 }
 
+// Gain from splitting a node with sums (G, H) into a left side (G_L, H_L) and the remainder
+__host__ __device__ inline double CalculateSplitGain(
+  double G_L, double H_L, double G, double H, double alpha)
+{
+  double G_R = G - G_L;
+  double H_R = H - H_L;
+  double reg = std::max(eps, alpha);  // Regularisation term
+  return 0.5 * ((G_L * G_L) / (H_L + reg) + (G_R * G_R) / (H_R + reg) - (G * G) / (H + reg));
+}
+
+// Chooses up to 2 * top_k features for each node from the top_k nominated by every worker
+// votes is [rank, node, top_k] with -1 where a worker nominated fewer features
+// Features with more votes come first, then lower indices, so every worker makes the same choice
+// Returns [node, 2 * top_k] padded with -1
+inline std::vector<int32_t> SelectVotedFeatures(const std::vector<int32_t>& votes,
+                                                size_t num_ranks,
+                                                int num_nodes,
+                                                int top_k)
+{
+  const int num_selected = 2 * top_k;
+  std::vector<int32_t> selected(num_nodes * num_selected, -1);
+  for (int node = 0; node < num_nodes; node++) {
+    std::map<int32_t, int> tally;
+    for (size_t r = 0; r < num_ranks; r++) {
+      for (int s = 0; s < top_k; s++) {
+        auto feature = votes[(r * num_nodes + node) * top_k + s];
+        if (feature >= 0) tally[feature]++;
+      }
+    }
+    std::vector<std::pair<int, int32_t>> ranked;  // (-votes, feature)
+    for (auto [feature, count] : tally) { ranked.push_back({-count, feature}); }
+    std::sort(ranked.begin(), ranked.end());
+    for (int i = 0; i < std::min<int>(ranked.size(), num_selected); i++) {
+      selected[node * num_selected + i] = ranked[i].second;
+    }
+  }
+  return selected;
+}
+
 struct GPair {
   double grad = 0.0;
   double hess = 0.0;
@@ -141,6 +230,9 @@ class SparseSplitProposals {
 class BuildTreeTask : public Task<BuildTreeTask, BUILD_TREE> {
  public:
   static void cpu_variant(legate::TaskContext context);
+#ifdef LEGATEBOOST_USE_OPENMP
+  static void omp_variant(legate::TaskContext context);
+#endif
 #ifdef LEGATEBOOST_USE_CUDA
   static void gpu_variant(legate::TaskContext context);
 #endif
@@ -20,13 +20,15 @@ namespace legateboost {
 
 namespace {
 struct predict_fn {
-  template <typename T>
-  void operator()(legate::TaskContext context)
+  template <typename T, typename Policy>
+  void operator()(legate::TaskContext context, Policy& policy)
   {
+    TaskProfile profile(context, 0);
     auto X          = context.input(0).data();
     auto X_shape    = X.shape<3>();
     auto X_accessor = X.read_accessor<T, 3>();
     EXPECT_DENSE_ROW_MAJOR(X_accessor.accessor, X_shape);
+    profile.Add(ProfileField::kRows, X_shape.hi[0] - X_shape.lo[0] + 1);
 
     auto leaf_value  = context.input(1).data().read_accessor<double, 2>();
     auto feature     = context.input(2).data().read_accessor<int32_t, 1>();
@@ -44,18 +46,23 @@ struct predict_fn {
     EXPECT_IS_BROADCAST(context.input(2).data().shape<1>());
     EXPECT_IS_BROADCAST(context.input(3).data().shape<1>());
 
-    for (int64_t i = X_shape.lo[0]; i <= X_shape.hi[0]; i++) {
-      int pos = 0;
-      // Use a max depth of 100 to avoid infinite loops
-      for (int depth = 0; depth < 100; depth++) {
-        if (feature[pos] == -1) break;
-        auto x = X_accessor[{i, feature[pos], 0}];
-        pos    = x <= split_value[pos] ? pos * 2 + 1 : pos * 2 + 2;
-      }
-      for (int64_t j = pred_shape.lo[2]; j <= pred_shape.hi[2]; j++) {
-        pred_accessor[{i, 0, j}] = leaf_value[{pos, j}];
-      }
-    }
+    // Rows are independent, the OpenMP variant spreads them over the processor's threads
+    thrust::for_each_n(policy,
+                       thrust::make_counting_iterator<int64_t>(X_shape.lo[0]),
+                       std::max<int64_t>(X_shape.hi[0] - X_shape.lo[0] + 1, 0),
+                       [&](int64_t i) {
+                         int pos = 0;
+                         // Use a max depth of 100 to avoid infinite loops
+                         for (int depth = 0; depth < 100; depth++) {
+                           if (feature[pos] == -1) break;
+                           auto x = X_accessor[{i, feature[pos], 0}];
+                           pos    = x <= split_value[pos] ? pos * 2 + 1 : pos * 2 + 2;
+                         }
+                         for (int64_t j = pred_shape.lo[2]; j <= pred_shape.hi[2]; j++) {
+                           pred_accessor[{i, 0, j}] = leaf_value[{pos, j}];
+                         }
+                       });
+    profile.Write();
   }
 };
 }  // namespace
@@ -63,9 +70,18 @@ struct predict_fn {
 /*static*/ void PredictTask::cpu_variant(legate::TaskContext context)
 {
   const auto& X = context.input(0).data();
-  type_dispatch_float(X.code(), predict_fn(), context);
+  type_dispatch_float(X.code(), predict_fn(), context, thrust::host);
 }
 
+#ifdef LEGATEBOOST_USE_OPENMP
+/*static*/ void PredictTask::omp_variant(legate::TaskContext context)
+{
+  const auto& X = context.input(0).data();
+  auto policy   = thrust::omp::par;
+  type_dispatch_float(X.code(), predict_fn(), context, policy);
+}
+#endif
+
 }  // namespace legateboost
 
 namespace  // unnamed
@@ -27,10 +27,12 @@ struct predict_fn {
   template <typename T>
   void operator()(legate::TaskContext context)
   {
+    TaskProfile profile(context, 0);
     const auto& X   = context.input(0).data();
     auto X_shape    = X.shape<3>();
     auto X_accessor = X.read_accessor<T, 3>();
     EXPECT_DENSE_ROW_MAJOR(X_accessor.accessor, X_shape);
+    profile.Add(ProfileField::kRows, X_shape.hi[0] - X_shape.lo[0] + 1);
 
     auto leaf_value  = context.input(1).data().read_accessor<double, 2>();
     auto feature     = context.input(2).data().read_accessor<int32_t, 1>();
@@ -69,6 +71,7 @@ struct predict_fn {
 
     auto stream = legate::cuda::StreamPool::get_stream_pool().get_stream();
     LaunchN(X_shape.hi[0] - X_shape.lo[0] + 1, stream, prediction_lambda);
+    StreamProfile(profile).Write(stream);
 
     CHECK_CUDA_STREAM(stream);
   }
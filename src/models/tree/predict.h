@@ -23,6 +23,9 @@ namespace legateboost {
 class PredictTask : public Task<PredictTask, PREDICT> {
  public:
   static void cpu_variant(legate::TaskContext context);
+#ifdef LEGATEBOOST_USE_OPENMP
+  static void omp_variant(legate::TaskContext context);
+#endif
 #ifdef LEGATEBOOST_USE_CUDA
   static void gpu_variant(legate::TaskContext context);
 #endif
@@ -20,18 +20,22 @@
 
 namespace legateboost {
 
-template <typename T, int DIM>
-void WriteOutput(legate::PhysicalStore out, const legate::Buffer<T, DIM>& x)
+// Folds a worker's node statistics into a store with SUM reduction privileges
+// The runtime combines the contributions of all workers, so no communicator is needed
+template <int DIM>
+void ReduceOutput(legate::PhysicalStore out, const legate::Buffer<double, DIM>& x)
 {
-  auto shape = out.shape<DIM>();
-  auto write = out.write_accessor<T, DIM>();
-  for (legate::PointInRectIterator<DIM> it(shape); it.valid(); ++it) { write[*it] = x[*it]; }
+  auto shape  = out.shape<DIM>();
+  auto reduce = out.reduce_accessor<legate::SumReduction<double>, true, DIM>();
+  for (legate::PointInRectIterator<DIM> it(shape); it.valid(); ++it) { reduce.reduce(*it, x[*it]); }
 }
 
 struct update_tree_fn {
-  template <typename T>
-  void operator()(legate::TaskContext context)
+  template <typename T, typename Policy>
+  void operator()(legate::TaskContext context, Policy& policy)
   {
+    // After the node statistics
+    TaskProfile profile(context, 2);
     const auto& X   = context.input(0).data();
     auto X_shape    = X.shape<3>();  // 3rd dimension is unused
     auto X_accessor = X.read_accessor<T, 3>();
@@ -50,8 +54,6 @@ struct update_tree_fn {
     const auto& split_proposals = context.input(3).data();
     EXPECT(g_shape.lo[2] == 0, "Expect all outputs to be present");
 
-    auto alpha = context.scalars().at(0).value<double>();
-
     // Tree structure
     auto feature     = context.input(3).data().read_accessor<int32_t, 1>();
     auto split_value = context.input(4).data().read_accessor<double, 1>();
@@ -60,54 +62,62 @@ struct update_tree_fn {
     EXPECT_IS_BROADCAST(context.input(3).data().shape<1>());
     EXPECT_IS_BROADCAST(context.input(4).data().shape<1>());
 
-    auto feature_shape  = context.input(3).data().shape<1>();
-    auto num_nodes      = feature_shape.hi[0] - feature_shape.lo[0] + 1;
-    auto new_leaf_value = legate::create_buffer<double, 2>({num_nodes, num_outputs});
-    auto new_gradient   = legate::create_buffer<double, 2>({num_nodes, num_outputs});
-    auto new_hessian    = legate::create_buffer<double, 2>({num_nodes, num_outputs});
+    auto feature_shape = context.input(3).data().shape<1>();
+    auto num_nodes     = feature_shape.hi[0] - feature_shape.lo[0] + 1;
+    auto new_gradient  = legate::create_buffer<double, 2>({num_nodes, num_outputs});
+    auto new_hessian   = legate::create_buffer<double, 2>({num_nodes, num_outputs});
 
-    for (int i = 0; i < num_nodes; i++) {
-      for (int j = 0; j < num_outputs; j++) {
-        new_leaf_value[{i, j}] = 0.0;
-        new_gradient[{i, j}]   = 0.0;
-        new_hessian[{i, j}]    = 0.0;
+    // Each thread walks a block of rows and sums into its own statistics
+    int64_t num_blocks = std::max<int64_t>(std::min<int64_t>(PolicyThreads(policy), num_rows), 1);
+    auto block_gradient = legate::create_buffer<double, 3>({num_blocks, num_nodes, num_outputs});
+    auto block_hessian  = legate::create_buffer<double, 3>({num_blocks, num_nodes, num_outputs});
+    for (int64_t b = 0; b < num_blocks; b++) {
+      for (int i = 0; i < num_nodes; i++) {
+        for (int j = 0; j < num_outputs; j++) {
+          block_gradient[{b, i, j}] = 0.0;
+          block_hessian[{b, i, j}]  = 0.0;
+        }
       }
     }
 
     // Walk through the tree and add the new statistics
-    for (int64_t i = X_shape.lo[0]; i <= X_shape.hi[0]; i++) {
-      int pos = 0;
-      // Use a max depth of 100 to avoid infinite loops
-      for (int depth = 0; depth < 100; depth++) {
-        for (int k = 0; k < num_outputs; k++) {
-          new_gradient[{pos, k}] += g_accessor[{i, 0, k}];
-          new_hessian[{pos, k}] += h_accessor[{i, 0, k}];
+    thrust::for_each_n(
+      policy, thrust::make_counting_iterator<int64_t>(0), num_blocks, [&](int64_t b) {
+        int64_t begin = X_shape.lo[0] + num_rows * b / num_blocks;
+        int64_t end   = X_shape.lo[0] + num_rows * (b + 1) / num_blocks;
+        for (int64_t i = begin; i < end; i++) {
+          int pos = 0;
+          // Use a max depth of 100 to avoid infinite loops
+          for (int depth = 0; depth < 100; depth++) {
+            for (int k = 0; k < num_outputs; k++) {
+              block_gradient[{b, pos, k}] += g_accessor[{i, 0, k}];
+              block_hessian[{b, pos, k}] += h_accessor[{i, 0, k}];
+            }
+            if (feature[pos] == -1) break;
+            auto x = X_accessor[{i, feature[pos], 0}];
+            pos    = x <= split_value[pos] ? pos * 2 + 1 : pos * 2 + 2;
+          }
         }
-        if (feature[pos] == -1) break;
-        auto x = X_accessor[{i, feature[pos], 0}];
-        pos    = x <= split_value[pos] ? pos * 2 + 1 : pos * 2 + 2;
-      }
-    }
-
-    // Sync the new statistics
-    SumAllReduce(context, new_gradient.ptr({0, 0}), num_nodes * num_outputs);
-    SumAllReduce(context, new_hessian.ptr({0, 0}), num_nodes * num_outputs);
+      });
 
-    // Update tree
+    // Add the blocks in order, so the sums only depend on the number of threads
     for (int i = 0; i < num_nodes; i++) {
       for (int j = 0; j < num_outputs; j++) {
-        auto H = new_hessian[{i, j}];
-        if (H > 0.0) {
-          new_leaf_value[{i, j}] = CalculateLeafValue(new_gradient[{i, j}], H, alpha);
-        } else {
-          new_leaf_value[{i, j}] = 0.0;
+        new_gradient[{i, j}] = 0.0;
+        new_hessian[{i, j}]  = 0.0;
+        for (int64_t b = 0; b < num_blocks; b++) {
+          new_gradient[{i, j}] += block_gradient[{b, i, j}];
+          new_hessian[{i, j}] += block_hessian[{b, i, j}];
         }
-        new_hessian[{i, j}] = new_hessian[{i, j}];
       }
     }
 
-    WriteOutput(context.output(0).data(), new_leaf_value);
-    WriteOutput(context.output(1).data(), new_hessian);
+    // Sum the new statistics over workers
+    // Leaf values are computed from the sums by the caller
+    ReduceOutput(context.reduction(0).data(), new_gradient);
+    ReduceOutput(context.reduction(1).data(), new_hessian);
+    profile.Add(ProfileField::kRows, num_rows);
+    profile.Write();
   }
 };
 
@@ -116,8 +126,16 @@ class UpdateTreeTask : public Task<UpdateTreeTask, UPDATE_TREE> {
   static void cpu_variant(legate::TaskContext context)
   {
     const auto& X = context.input(0).data();
-    type_dispatch_float(X.code(), update_tree_fn(), context);
+    type_dispatch_float(X.code(), update_tree_fn(), context, thrust::host);
+  }
+#ifdef LEGATEBOOST_USE_OPENMP
+  static void omp_variant(legate::TaskContext context)
+  {
+    const auto& X = context.input(0).data();
+    auto policy   = thrust::omp::par;
+    type_dispatch_float(X.code(), update_tree_fn(), context, policy);
   }
+#endif
 };
 
 }  // namespace legateboost
@@ -0,0 +1,250 @@
+/* Copyright 2024, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>    // for int32_t
+#include <algorithm>  // for max
+#include <cmath>      // for exp, log, pow
+#include "special.h"
+
+namespace legateboost {
+
+// Must match _ExprOp in special.py
+enum class ExprOp : std::int32_t {
+  kConst   = 0,
+  kAdd     = 1,
+  kSub     = 2,
+  kMul     = 3,
+  kDiv     = 4,
+  kNeg     = 5,
+  kExp     = 6,
+  kLog     = 7,
+  kSqrt    = 8,
+  kPow     = 9,
+  kErf     = 10,
+  kLgamma  = 11,
+  kTgamma  = 12,
+  kDigamma = 13,
+  kZeta    = 14,
+  kMax     = 15,
+};
+
+// reg[dst] = op(reg[a], reg[b]), kConst loads constants[a]
+struct ExprInstruction {
+  ExprOp op;
+  std::int32_t dst;
+  std::int32_t a;
+  std::int32_t b;
+};
+
+// Ops that read reg[b], the others ignore it
+inline bool IsBinary(ExprOp op)
+{
+  return op == ExprOp::kAdd || op == ExprOp::kSub || op == ExprOp::kMul || op == ExprOp::kDiv ||
+         op == ExprOp::kPow || op == ExprOp::kZeta || op == ExprOp::kMax;
+}
+
+constexpr int kMaxExprRegisters    = 32;
+constexpr int kMaxExprInstructions = 64;
+constexpr int kMaxExprConstants    = 16;
+constexpr int kMaxExprInputs       = 8;
+constexpr int kMaxExprOutputs      = 4;
+
+// A compiled expression, passed by value to kernels
+// Registers [0, num_inputs) hold the inputs, outputs name the registers written out
+struct ExprProgram {
+  ExprInstruction instructions[kMaxExprInstructions];
+  double constants[kMaxExprConstants];
+  std::int32_t outputs[kMaxExprOutputs];
+  int num_instructions;
+  int num_inputs;
+  int num_outputs;
+};
+
+template <typename T>
+__host__ __device__ inline void EvalExpr(const ExprProgram& program, T* reg)
+{
+  for (int i = 0; i < program.num_instructions; i++) {
+    const auto& ins = program.instructions[i];
+    T& dst          = reg[ins.dst];
+    switch (ins.op) {
+      case ExprOp::kConst: dst = T(program.constants[ins.a]); break;
+      case ExprOp::kAdd: dst = reg[ins.a] + reg[ins.b]; break;
+      case ExprOp::kSub: dst = reg[ins.a] - reg[ins.b]; break;
+      case ExprOp::kMul: dst = reg[ins.a] * reg[ins.b]; break;
+      case ExprOp::kDiv: dst = reg[ins.a] / reg[ins.b]; break;
+      case ExprOp::kNeg: dst = -reg[ins.a]; break;
+      case ExprOp::kExp: dst = std::exp(reg[ins.a]); break;
+      case ExprOp::kLog: dst = std::log(reg[ins.a]); break;
+      case ExprOp::kSqrt: dst = std::sqrt(reg[ins.a]); break;
+      case ExprOp::kPow: dst = std::pow(reg[ins.a], reg[ins.b]); break;
+      case ExprOp::kErf: dst = std::erf(reg[ins.a]); break;
+      case ExprOp::kLgamma: dst = std::lgamma(reg[ins.a]); break;
+      case ExprOp::kTgamma: dst = std::tgamma(reg[ins.a]); break;
+      case ExprOp::kDigamma: dst = calc_digamma(reg[ins.a]); break;
+      case ExprOp::kZeta: dst = T(zeta(reg[ins.a], reg[ins.b])); break;
+      // NaN in either operand propagates, as in cn.maximum
+      case ExprOp::kMax:
+        dst = reg[ins.a] > reg[ins.b] || reg[ins.a] != reg[ins.a] ? reg[ins.a] : reg[ins.b];
+        break;
+    }
+  }
+}
+
+// Raw pointers or accessors of every input and output, copied into kernels
+template <typename T, std::int32_t kDim>
+struct ExprAccessors {
+  legate::AccessorRO<T, kDim> in[kMaxExprInputs];
+  legate::AccessorWO<T, kDim> out[kMaxExprOutputs];
+};
+
+template <typename T>
+struct ExprPointers {
+  const T* in[kMaxExprInputs];
+  T* out[kMaxExprOutputs];
+};
+
+// Evaluates a chain of elementwise ops in a single pass over memory, replacing one task and one
+// temporary per op. All inputs and outputs share a shape and type.
+class ElementwiseExprTask : public Task<ElementwiseExprTask, ELEMENTWISE_EXPR> {
+ public:
+  static ExprProgram ReadProgram(legate::TaskContext& context)
+  {
+    auto instructions = context.scalar(0).values<std::int32_t>();
+    auto constants    = context.scalar(1).values<double>();
+    auto outputs      = context.scalar(2).values<std::int32_t>();
+    ExprProgram program;
+    program.num_instructions = static_cast<int>(instructions.size() / 4);
+    program.num_inputs       = context.num_inputs();
+    program.num_outputs      = context.num_outputs();
+    int num_constants        = static_cast<int>(constants.size());
+    EXPECT(program.num_instructions <= kMaxExprInstructions, "Expression too long.");
+    EXPECT(num_constants <= kMaxExprConstants, "Too many expression constants.");
+    EXPECT(program.num_inputs <= kMaxExprInputs, "Too many expression inputs.");
+    EXPECT(program.num_outputs <= kMaxExprOutputs &&
+             static_cast<int>(outputs.size()) == program.num_outputs,
+           "Expression outputs do not match the output stores.");
+    // Every instruction writes a new register from registers written before it, so a program
+    // can only read inputs and earlier results
+    int num_registers = program.num_inputs;
+    for (int i = 0; i < program.num_instructions; i++) {
+      ExprInstruction ins = {static_cast<ExprOp>(instructions[4 * i]),
+                             instructions[4 * i + 1],
+                             instructions[4 * i + 2],
+                             instructions[4 * i + 3]};
+      EXPECT(ins.op >= ExprOp::kConst && ins.op <= ExprOp::kMax, "Unknown expression op.");
+      EXPECT(ins.dst >= program.num_inputs && ins.dst < kMaxExprRegisters,
+             "Expression register out of range.");
+      if (ins.op == ExprOp::kConst) {
+        EXPECT(ins.a >= 0 && ins.a < num_constants, "Expression constant out of range.");
+      } else {
+        EXPECT(ins.a >= 0 && ins.a < ins.dst && ins.a < num_registers,
+               "Expression register read before it is written.");
+      }
+      if (IsBinary(ins.op)) {
+        EXPECT(ins.b >= 0 && ins.b < ins.dst && ins.b < num_registers,
+               "Expression register read before it is written.");
+      }
+      num_registers           = std::max(num_registers, ins.dst + 1);
+      program.instructions[i] = ins;
+    }
+    for (int i = 0; i < num_constants; i++) { program.constants[i] = constants[i]; }
+    for (int i = 0; i < program.num_outputs; i++) {
+      EXPECT(outputs[i] >= 0 && outputs[i] < num_registers, "Expression output out of range.");
+      program.outputs[i] = outputs[i];
+    }
+    return program;
+  }
+
+  template <std::int32_t kDim, typename Policy>
+  struct DispatchTypeOp {
+    template <typename T>
+    void operator()(legate::TaskContext& context, const ExprProgram& program, Policy& policy)
+    {
+      auto shape = context.output(0).shape<kDim>();
+      auto v     = shape.volume();
+      bool dense = true;
+      ExprAccessors<T, kDim> accessors;
+      for (int i = 0; i < program.num_inputs; i++) {
+        EXPECT(context.input(i).shape<kDim>() == shape, "Expression inputs must share a shape.");
+        accessors.in[i] = context.input(i).data().read_accessor<T, kDim>();
+        dense           = dense && accessors.in[i].accessor.is_dense_row_major(shape);
+      }
+      for (int i = 0; i < program.num_outputs; i++) {
+        EXPECT(context.output(i).shape<kDim>() == shape, "Expression outputs must share a shape.");
+        accessors.out[i] = context.output(i).data().write_accessor<T, kDim>();
+        dense            = dense && accessors.out[i].accessor.is_dense_row_major(shape);
+      }
+      if (v == 0) return;
+
+      if (dense) {
+        ExprPointers<T> p;
+        for (int i = 0; i < program.num_inputs; i++) { p.in[i] = accessors.in[i].ptr(shape); }
+        for (int i = 0; i < program.num_outputs; i++) { p.out[i] = accessors.out[i].ptr(shape); }
+        thrust::for_each_n(policy,
+                           thrust::make_counting_iterator<std::int64_t>(0),
+                           v,
+                           [=] __host__ __device__(std::int64_t idx) {
+                             T reg[kMaxExprRegisters];
+                             for (int i = 0; i < program.num_inputs; i++) { reg[i] = p.in[i][idx]; }
+                             EvalExpr(program, reg);
+                             for (int i = 0; i < program.num_outputs; i++) {
+                               p.out[i][idx] = reg[program.outputs[i]];
+                             }
+                           });
+        return;
+      }
+
+      thrust::for_each_n(
+        policy, UnravelIter(shape), v, [=] __host__ __device__(const legate::Point<kDim>& q) {
+          T reg[kMaxExprRegisters];
+          for (int i = 0; i < program.num_inputs; i++) { reg[i] = accessors.in[i][q]; }
+          EvalExpr(program, reg);
+          for (int i = 0; i < program.num_outputs; i++) {
+            accessors.out[i][q] = reg[program.outputs[i]];
+          }
+        });
+    }
+  };
+  struct DispatchDimOp {
+    template <std::int32_t kDim, typename Policy>
+    void operator()(legate::TaskContext& context, const ExprProgram& program, Policy& policy)
+    {
+      type_dispatch_float(context.output(0).type().code(),
+                          DispatchTypeOp<kDim, Policy>{},
+                          context,
+                          program,
+                          policy);
+    }
+  };
+  static void cpu_variant(legate::TaskContext context)
+  {
+    auto program = ReadProgram(context);
+    legate::dim_dispatch(context.output(0).dim(), DispatchDimOp{}, context, program, thrust::host);
+  }
+#ifdef LEGATEBOOST_USE_OPENMP
+  static void omp_variant(legate::TaskContext context)
+  {
+    auto program = ReadProgram(context);
+    auto policy  = thrust::omp::par;
+    legate::dim_dispatch(context.output(0).dim(), DispatchDimOp{}, context, program, policy);
+  }
+#endif
+#ifdef LEGATEBOOST_USE_CUDA
+  static void gpu_variant(legate::TaskContext context);
+#endif
+};
+
+}  // namespace legateboost
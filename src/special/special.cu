@@ -13,6 +13,20 @@
  * limitations under the License.
  */
 #include "special.h"
+#include "expression.h"
+
+namespace legateboost {
+/*static*/ void ElementwiseExprTask::gpu_variant(legate::TaskContext context)
+{
+  auto program            = ReadProgram(context);
+  auto stream             = legate::cuda::StreamPool::get_stream_pool().get_stream();
+  auto thrust_alloc       = ThrustAllocator(legate::Memory::GPU_FB_MEM);
+  auto thrust_exec_policy = DEFAULT_POLICY(thrust_alloc).on(stream);
+  legate::dim_dispatch(
+    context.output(0).dim(), DispatchDimOp{}, context, program, thrust_exec_policy);
+}
+}  // namespace legateboost
+
 namespace  // unnamed
 {
 static void __attribute__((constructor)) register_tasks(void)
@@ -22,5 +36,6 @@ static void __attribute__((constructor)) register_tasks(void)
   legateboost::TgammaTask::register_variants();
   legateboost::DigammaTask::register_variants();
   legateboost::ZetaTask::register_variants();
+  legateboost::ElementwiseExprTask::register_variants();
 }
 }  // namespace
@@ -14,6 +14,7 @@
  */
 #pragma once
 
+#include <cstddef>                              // for size_t
 #include <cstdint>                              // for int32_t
 #include <type_traits>                          // for is_same_v
 #include <legate/core/task/task_context.h>      // for TaskContext
@@ -48,12 +49,15 @@ inline constexpr double m_PI = 3.14159265358979323846;
  *
  * coef[0] = C  , ..., coef[N] = C  .
  *            N                   0
+ *
+ * The degree is taken from the array length so the Horner loop is fully unrolled, leaving the
+ * elementwise loop around it free to vectorise.
  */
-template <typename T>
-__host__ __device__ inline T polevl(const T x, const T A[], size_t len)
+template <typename T, std::size_t N>
+__host__ __device__ inline T polevl(const T x, const T (&A)[N])
 {
   T result = 0;
-  for (size_t i = 0; i <= len; i++) { result = result * x + A[i]; }
+  for (std::size_t i = 0; i < N; i++) { result = result * x + A[i]; }
   return result;
 }
 
@@ -86,11 +90,13 @@ __host__ __device__ inline double calc_digamma(double x)
     return calc_digamma(1 - x) - m_PI / std::tan(m_PI * r);
   }
 
-  // Push x to be >= 10
+  // Push x to be >= 10, x > 0 here so ten steps always suffice. A fixed trip count keeps the
+  // loop branch free across elements.
   double result = 0;
-  while (x < 10) {
-    result -= 1 / x;
-    x += 1;
+  for (int i = 0; i < 10; i++) {
+    bool shift = x < 10;
+    result -= shift ? 1 / x : 0.0;
+    x += shift ? 1.0 : 0.0;
   }
   if (x == 10) { return result + PSI_10; }
 
@@ -108,7 +114,7 @@ __host__ __device__ inline double calc_digamma(double x)
   double y = 0;
   if (x < 1.0e17) {
     double z = 1.0 / (x * x);
-    y        = z * polevl(z, A, 6);
+    y        = z * polevl(z, A);
   }
   return result + log(x) - (0.5 / x) - y;
 }
@@ -144,11 +150,12 @@ __host__ __device__ inline float calc_digamma(float x)
     return calc_digamma(1 - x) - pi_over_tan_pi_x;
   }
 
-  // Push x to be >= 10
+  // Push x to be >= 10, see the double overload
   float result = 0;
-  while (x < 10) {
-    result -= 1 / x;
-    x += 1;
+  for (int i = 0; i < 10; i++) {
+    bool shift = x < 10;
+    result -= shift ? 1 / x : 0.0f;
+    x += shift ? 1.0f : 0.0f;
   }
   if (x == 10) { return result + PSI_10; }
 
@@ -166,7 +173,7 @@ __host__ __device__ inline float calc_digamma(float x)
   float y = 0;
   if (x < 1.0e17f) {
     float z = 1 / (x * x);
-    y       = z * polevl(z, A, 6);
+    y       = z * polevl(z, A);
   }
   return result + logf(x) - (0.5f / x) - y;
 }
@@ -183,7 +190,7 @@ __host__ __device__ inline double zeta(double x, double q)
    * (2k)! / B2k
    * where B2k are Bernoulli numbers
    */
-  static double A[] = {
+  constexpr double A[] = {
     12.0,
     -720.0,
     30240.0,
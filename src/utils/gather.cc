@@ -27,6 +27,7 @@ struct gather_fn {
   template <typename T>
   void operator()(legate::TaskContext context)
   {
+    TaskProfile profile(context, 0);
     const auto& X   = context.input(0).data();
     auto X_shape    = X.shape<2>();
     auto X_accessor = X.read_accessor<T, 2>();
@@ -55,16 +56,29 @@ struct gather_fn {
       sample_row_ptr            = sample_rows_accessor.ptr(0);
     }
 
+    // Pack only the sampled rows this rank owns
+    std::vector<int32_t> positions;
     for (int i = 0; i < n_samples; i++) {
-      auto row      = sample_row_ptr[i];
-      bool has_data = row >= X_shape.lo[0] && row <= X_shape.hi[0];
-      for (int j = 0; j < n_features; j++) {
-        split_proposals_accessor[{i, j}] = has_data ? X_accessor[{row, j}] : T(0);
-      }
+      auto row = sample_row_ptr[i];
+      if (row >= X_shape.lo[0] && row <= X_shape.hi[0]) { positions.push_back(i); }
+    }
+    std::vector<T> rows(positions.size() * n_features);
+    for (size_t k = 0; k < positions.size(); k++) {
+      auto row = sample_row_ptr[positions[k]];
+      for (int j = 0; j < n_features; j++) { rows[k * n_features + j] = X_accessor[{row, j}]; }
     }
 
-    SumAllReduce(
-      context, reinterpret_cast<T*>(split_proposals_accessor.ptr({0, 0})), n_samples * n_features);
+    profile.Add(ProfileField::kRows, positions.size());
+    profile.Add(ProfileField::kBytesReduced, rows.size() * sizeof(T));
+    profile.Time(ProfileField::kAllReduce, [&] {
+      AllGatherRows(context,
+                    rows.data(),
+                    positions.data(),
+                    positions.size(),
+                    n_features,
+                    reinterpret_cast<T*>(split_proposals_accessor.ptr({0, 0})));
+    });
+    profile.Write();
   }
 };
 
@@ -76,6 +90,11 @@ struct gather_fn {
   type_dispatch_float(X.code(), gather_fn(), context);
 }
 
+#ifdef LEGATEBOOST_USE_OPENMP
+// Copies only the sampled rows, too little work to share between threads
+/*static*/ void GatherTask::omp_variant(legate::TaskContext context) { cpu_variant(context); }
+#endif
+
 }  // namespace legateboost
 
 namespace  // unnamed
@@ -19,6 +19,8 @@
 #include "../cpp_utils/cpp_utils.cuh"
 #include "../cpp_utils/cpp_utils.h"
 #include "gather.h"
+#include <thrust/copy.h>
+#include <thrust/iterator/counting_iterator.h>
 
 namespace legateboost {
 
@@ -27,6 +29,8 @@ struct gather_fn {
   template <typename T>
   void operator()(legate::TaskContext context)
   {
+    TaskProfile profile(context, 0);
+    StreamProfile stream_profile(profile);
     const auto& X   = context.input(0).data();
     auto X_shape    = X.shape<2>();
     auto X_accessor = X.read_accessor<T, 2>();
@@ -68,20 +72,41 @@ struct gather_fn {
       sample_row_ptr            = sample_rows_accessor.ptr(0);
     }
 
-    // fill with local data
-    LaunchN(n_features * n_samples, stream, [=] __device__(auto idx) {
-      auto i                           = idx / n_features;
-      auto j                           = idx % n_features;
-      auto row                         = sample_row_ptr[i];
-      bool has_data                    = row >= X_shape.lo[0] && row <= X_shape.hi[0];
-      split_proposals_accessor[{i, j}] = has_data ? X_accessor[{row, j}] : T(0);
+    // Pack only the sampled rows this rank owns
+    auto thrust_alloc = ThrustAllocator(legate::Memory::GPU_FB_MEM);
+    auto policy       = DEFAULT_POLICY(thrust_alloc).on(stream);
+    auto positions    = legate::create_buffer<int32_t, 1>(n_samples);
+    auto counting     = thrust::make_counting_iterator<int32_t>(0);
+    auto positions_end =
+      thrust::copy_if(policy,
+                      counting,
+                      counting + n_samples,
+                      positions.ptr(0),
+                      [=] __device__(int32_t i) {
+                        auto row = sample_row_ptr[i];
+                        return row >= X_shape.lo[0] && row <= X_shape.hi[0];
+                      });
+    int32_t n_owned    = positions_end - positions.ptr(0);
+    auto rows          = legate::create_buffer<T, 1>(n_owned * n_features);
+    auto positions_ptr = positions.ptr(0);
+    auto rows_ptr      = rows.ptr(0);
+    LaunchN(n_owned * n_features, stream, [=] __device__(auto idx) {
+      auto row      = sample_row_ptr[positions_ptr[idx / n_features]];
+      rows_ptr[idx] = X_accessor[{row, idx % n_features}];
     });
 
-    // use NCCL for reduction
-    SumAllReduce(context,
-                 reinterpret_cast<T*>(split_proposals_accessor.ptr({0, 0})),
-                 n_features * n_samples,
-                 stream);
+    profile.Add(ProfileField::kRows, n_owned);
+    profile.Add(ProfileField::kBytesReduced, n_owned * n_features * sizeof(T));
+    stream_profile.Time(ProfileField::kAllReduce, stream, [&] {
+      AllGatherRows(context,
+                    rows_ptr,
+                    positions_ptr,
+                    n_owned,
+                    n_features,
+                    reinterpret_cast<T*>(split_proposals_accessor.ptr({0, 0})),
+                    stream);
+    });
+    stream_profile.Write(stream);
 
     CHECK_CUDA_STREAM(stream);
   }
@@ -22,6 +22,9 @@ namespace legateboost {
 class GatherTask : public Task<GatherTask, GATHER> {
  public:
   static void cpu_variant(legate::TaskContext context);
+#ifdef LEGATEBOOST_USE_OPENMP
+  static void omp_variant(legate::TaskContext context);
+#endif
 #ifdef LEGATEBOOST_USE_CUDA
   static void gpu_variant(legate::TaskContext context);
 #endif
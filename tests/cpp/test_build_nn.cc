@@ -0,0 +1,78 @@
+/* Copyright 2024 NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "models/nn/build_nn.h"
+#include <cstdio>
+#include <vector>
+
+// Host only helpers of the NN tasks that the Python tests cannot reach directly
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const char* what)
+{
+  if (condition) return;
+  std::fprintf(stderr, "FAILED: %s\n", what);
+  failures++;
+}
+
+// Local rows of each step in the current epoch
+std::vector<std::vector<int64_t>> Batches(const legateboost::MiniBatchSchedule& schedule)
+{
+  std::vector<std::vector<int64_t>> result;
+  for (int64_t step = 0; step < schedule.steps_per_epoch; step++) {
+    auto [begin, end] = schedule.Batch(step);
+    result.emplace_back(schedule.Order().begin() + begin, schedule.Order().begin() + end);
+  }
+  return result;
+}
+
+void TestMiniBatchSchedule()
+{
+  using legateboost::MiniBatchSchedule;
+  // 10 of 40 rows on this rank, a global batch of 8 rows is 5 steps of 2 local rows
+  MiniBatchSchedule schedule(10, 40, 8, 0);
+  Check(schedule.steps_per_epoch == 5, "steps counted from the global rows");
+  Check(schedule.local_batch_size == 2, "each step takes its share of the local rows");
+
+  bool rows_change = false;
+  auto first       = Batches(schedule);
+  for (int epoch = 0; epoch < 4; epoch++) {
+    schedule.Shuffle();
+    auto batches = Batches(schedule);
+    std::vector<int> seen(10, 0);
+    for (const auto& batch : batches) {
+      for (auto row : batch) seen.at(row)++;
+    }
+    Check(seen == std::vector<int>(10, 1), "every local row in exactly one batch");
+    rows_change = rows_change || batches.front() != first.front();
+  }
+  Check(rows_change, "batches hold different rows across epochs");
+
+  // A rank without rows still takes every step
+  MiniBatchSchedule empty(0, 40, 8, 0);
+  Check(empty.steps_per_epoch == 5, "empty rank takes the same steps");
+  Check(empty.Batch(4) == std::make_tuple(int64_t(0), int64_t(0)), "empty rank has empty batches");
+}
+
+}  // namespace
+
+int main()
+{
+  TestMiniBatchSchedule();
+  if (failures == 0) std::printf("All build_nn tests passed\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/* Copyright 2024 NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "models/tree/build_tree.h"
+#include <cstdio>
+#include <vector>
+
+// Host only helpers of the tree tasks that the Python tests cannot reach directly
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const char* what)
+{
+  if (condition) return;
+  std::fprintf(stderr, "FAILED: %s\n", what);
+  failures++;
+}
+
+void TestSelectVotedFeatures()
+{
+  using legateboost::SelectVotedFeatures;
+  // votes[rank, node, top_k] of 3 ranks, 2 nodes and top_k 2
+  std::vector<int32_t> votes = {
+    5, 1, -1, -1,  // rank 0
+    1, 3, 7, -1,   // rank 1
+    3, -1, -1, -1  // rank 2
+  };
+  // Node 0: features 1 and 3 have two votes each, the tie goes to the lower index, 5 has one vote
+  // Node 1: only feature 7 has a vote, the remaining slots are padded
+  std::vector<int32_t> expected = {1, 3, 5, -1, 7, -1, -1, -1};
+  Check(SelectVotedFeatures(votes, 3, 2, 2) == expected, "votes ranked then padded");
+
+  // With more candidates than the 2 * top_k slots, equal votes keep the lowest feature indices
+  Check(SelectVotedFeatures({9, 4, 2}, 3, 1, 1) == std::vector<int32_t>({2, 4}),
+        "ties truncated to the lowest indices");
+  // More votes beat a lower index
+  Check(SelectVotedFeatures({8, 0, 8}, 3, 1, 1) == std::vector<int32_t>({8, 0}),
+        "votes ranked before indices");
+  // No votes at all
+  Check(SelectVotedFeatures({-1, -1}, 2, 1, 1) == std::vector<int32_t>({-1, -1}),
+        "no votes are all padding");
+}
+
+void TestUseSparseHistogram()
+{
+  using legateboost::UseSparseHistogram;
+  // 100 bins over 2 ranks: a dense allreduce of doubles moves 2 * 100 * 16 = 3200 bytes, sparse
+  // pairs 2 * 20 bytes per non-empty bin
+  Check(UseSparseHistogram(100, 79, 2, sizeof(double)), "sparse below the double crossover");
+  Check(!UseSparseHistogram(100, 80, 2, sizeof(double)), "dense at the double crossover");
+  // float32 values: 1600 dense bytes against 2 * 12 bytes per non-empty bin
+  Check(UseSparseHistogram(100, 66, 2, sizeof(float)), "sparse below the float crossover");
+  Check(!UseSparseHistogram(100, 67, 2, sizeof(float)), "dense above the float crossover");
+  // Every rank's pairs are received, so more ranks lower the crossover
+  Check(!UseSparseHistogram(100, 40, 4, sizeof(double)), "dense at the 4 rank crossover");
+  Check(UseSparseHistogram(100, 39, 4, sizeof(double)), "sparse below the 4 rank crossover");
+}
+
+}  // namespace
+
+int main()
+{
+  TestSelectVotedFeatures();
+  TestUseSparseHistogram();
+  if (failures == 0) std::printf("All build_tree tests passed\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+/* Copyright 2024 NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "legate.h"
+#include "legateboost.h"
+#include "api/estimator.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+
+// The C++ front-end trained end to end, it has no Python counterpart to test it through
+namespace {
+
+constexpr int64_t kRows     = 2000;
+constexpr int64_t kFeatures = 4;
+
+int failures = 0;
+
+void Check(bool condition, const char* what)
+{
+  if (condition) return;
+  std::fprintf(stderr, "FAILED: %s\n", what);
+  failures++;
+}
+
+legate::LogicalStore CreateStore(const legate::Type& type, uint64_t cols)
+{
+  return legate::Runtime::get_runtime()->create_store(legate::Shape{kRows, cols}, type);
+}
+
+// Uniform features in [-1, 1], y = x0 + x1 * x2 and labels = y > 0
+void MakeData(legate::LogicalStore& X, legate::LogicalStore& y, legate::LogicalStore& labels)
+{
+  auto X_store     = X.get_physical_store();
+  auto y_store     = y.get_physical_store();
+  auto label_store = labels.get_physical_store();
+  auto X_acc       = X_store.write_accessor<float, 2>();
+  auto y_acc       = y_store.write_accessor<double, 2>();
+  auto label_acc   = label_store.write_accessor<double, 2>();
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  float x[kFeatures];
+  for (int64_t i = 0; i < kRows; i++) {
+    for (int64_t j = 0; j < kFeatures; j++) {
+      x[j]          = uniform(rng);
+      X_acc[{i, j}] = x[j];
+    }
+    y_acc[{i, 0}]     = x[0] + x[1] * x[2];
+    label_acc[{i, 0}] = y_acc[{i, 0}] > 0.0 ? 1.0 : 0.0;
+  }
+}
+
+double MeanSquaredError(const legate::LogicalStore& a, const legate::LogicalStore& b)
+{
+  auto a_store = a.get_physical_store();
+  auto b_store = b.get_physical_store();
+  auto a_acc   = a_store.read_accessor<double, 2>();
+  auto b_acc   = b_store.read_accessor<double, 2>();
+  double sum   = 0.0;
+  for (int64_t i = 0; i < kRows; i++) {
+    double diff = a_acc[{i, 0}] - b_acc[{i, 0}];
+    sum += diff * diff;
+  }
+  return sum / kRows;
+}
+
+int32_t GetTunable(LegateBoostTunable tunable)
+{
+  auto library = legate::Runtime::get_runtime()->find_library("legateboost");
+  return library.get_tunable(tunable, legate::int32()).value<int32_t>();
+}
+
+void TestRegressor(const legate::LogicalStore& X, const legate::LogicalStore& y)
+{
+  legateboost::LBParams params;
+  params.n_estimators   = 10;
+  params.learning_rate  = 0.5;
+  params.tree.max_depth = 4;
+  legateboost::LBRegressor regressor(params);
+  regressor.Fit(X, y);
+  Check(regressor.Models().size() == 10, "fit trains n_estimators trees");
+
+  // The mean of y predicts with the variance of y as error
+  legateboost::LBParams init_only = params;
+  init_only.n_estimators          = 0;
+  legateboost::LBRegressor mean(init_only);
+  auto init_error = MeanSquaredError(mean.Fit(X, y).PredictRaw(X), y);
+  auto error      = MeanSquaredError(regressor.Predict(X), y);
+  Check(error < 0.5 * init_error, "boosting improves on the mean");
+
+  regressor.PartialFit(X, y);
+  Check(regressor.Models().size() == 20, "partial fit adds n_estimators trees");
+  Check(MeanSquaredError(regressor.Predict(X), y) <= error, "partial fit does not increase error");
+}
+
+// Unset tree parameters take the mapper's tunables, as None does in Python
+void TestTunableDefaults(const legate::LogicalStore& X, const legate::LogicalStore& y)
+{
+  legateboost::LBParams params;
+  params.n_estimators = 5;
+  Check(!params.tree.split_samples && !params.tree.histogram_chunks,
+        "split_samples and histogram_chunks are unset by default");
+  legateboost::LBParams explicit_params = params;
+  explicit_params.tree.split_samples    = GetTunable(TUNABLE_SPLIT_SAMPLES);
+  explicit_params.tree.histogram_chunks = GetTunable(TUNABLE_HISTOGRAM_CHUNKS);
+  auto pred          = legateboost::LBRegressor(params).Fit(X, y).PredictRaw(X);
+  auto explicit_pred = legateboost::LBRegressor(explicit_params).Fit(X, y).PredictRaw(X);
+  Check(MeanSquaredError(pred, explicit_pred) == 0.0, "defaults match the tunables");
+
+  legateboost::LBParams invalid;
+  invalid.tree.histogram_chunks = 0;
+  bool threw                   = false;
+  try {
+    legateboost::LBRegressor regressor(invalid);
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  Check(threw, "histogram_chunks below 1 is rejected");
+}
+
+void TestClassifier(const legate::LogicalStore& X, const legate::LogicalStore& labels)
+{
+  legateboost::LBParams params;
+  params.n_estimators = 10;
+  legateboost::LBClassifier classifier(params);
+  auto proba_store = classifier.Fit(X, labels).PredictProba(X).get_physical_store();
+  auto label_store = labels.get_physical_store();
+  auto proba_acc   = proba_store.read_accessor<double, 2>();
+  auto label_acc   = label_store.read_accessor<double, 2>();
+  int64_t correct  = 0;
+  bool in_range    = true;
+  for (int64_t i = 0; i < kRows; i++) {
+    in_range = in_range && proba_acc[{i, 0}] >= 0.0 && proba_acc[{i, 0}] <= 1.0;
+    correct += (proba_acc[{i, 0}] > 0.5) == (label_acc[{i, 0}] > 0.5);
+  }
+  Check(in_range, "probabilities are in [0, 1]");
+  Check(correct > 0.9 * kRows, "classifier separates the labels");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if (auto result = legate::start(argc, argv); result != 0) { return result; }
+  legateboost_perform_registration();
+
+  auto X      = CreateStore(legate::float32(), kFeatures);
+  auto y      = CreateStore(legate::float64(), 1);
+  auto labels = CreateStore(legate::float64(), 1);
+  MakeData(X, y, labels);
+
+  TestRegressor(X, y);
+  TestTunableDefaults(X, y);
+  TestClassifier(X, labels);
+
+  if (auto result = legate::finish(); result != 0) { return result; }
+  if (failures == 0) std::printf("All estimator tests passed\n");
+  return failures == 0 ? 0 : 1;
+}